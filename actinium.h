@@ -14,35 +14,179 @@
 #include "magnesium.h"
 #include "ac_port.h"
 
+/*
+ * Number of additional message slots per actor. Each slot takes one spare
+ * MPU/PMP region, so the value is limited by the port.
+ */
+#ifndef AC_MSG_SLOTS
+#define AC_MSG_SLOTS 0
+#endif
+
+/*
+ * Number of message priorities in priority-ordered channels.
+ */
+#ifndef AC_MSG_PRIO_NUM
+#define AC_MSG_PRIO_NUM 8
+#endif
+
+/*
+ * Hardware FPU support for actors with the FPU flag. Requires the port 
+ * support, ARM ports also need the assembler symbol of the same name.
+ */
+#ifndef AC_PORT_FPU
+#define AC_PORT_FPU 0
+#endif
+
+/*
+ * Tickless mode: the timer interrupt comes only when the earliest timeout
+ * expires instead of every tick. Requires the timer hooks of the port.
+ */
+#ifndef AC_TICKLESS
+#define AC_TICKLESS 0
+#endif
+
+/*
+ * Hierarchical timer wheel holds the timeouts of actors instead of magnesium
+ * timers and the timed list, so the tick cost doesn't depend on the number 
+ * of waiting actors. Each level has 2^AC_WHEEL_BITS slots.
+ */
+#ifndef AC_TIMER_WHEEL
+#define AC_TIMER_WHEEL 0
+#endif
+
+/*
+ * Microsecond timer of the tickless mode: the port timer counts microseconds
+ * instead of ticks, so microsecond delays are exact. Delays in ticks are 
+ * scaled by the tick length, in other modes microsecond delays are rounded 
+ * up to ticks.
+ */
+#ifndef AC_TIMER_US
+#define AC_TIMER_US 0
+#endif
+
+#ifndef AC_TICK_US
+#define AC_TICK_US 1000
+#endif
+
+#ifndef AC_WHEEL_BITS
+#define AC_WHEEL_BITS 5
+#endif
+
+#if AC_TIMER_WHEEL && AC_TICKLESS
+#error Timer wheel is not supported in tickless mode.
+#endif
+
+#if AC_TIMER_US && !AC_TICKLESS
+#error Microsecond timer requires tickless mode.
+#endif
+
+/*
+ * Port may mirror more hardware regions than the actor has, the extra ones
+ * follow the actor's regions in the loaded array and start empty.
+ */
+#ifndef AC_PORT_MIRROR_EXTRA
+#define AC_PORT_MIRROR_EXTRA 0
+#endif
+
 enum {
     AC_CALL_DELAY,
     AC_CALL_SUBSCRIBE,
     AC_CALL_TRY_POP,
     AC_CALL_PUSH,
     AC_CALL_FREE,
+    AC_CALL_PUSH_SUBSCRIBE,
+    AC_CALL_SLOT,
+    AC_CALL_SELECT,
+    AC_CALL_SUBSCRIBE_TIMED,
+    AC_CALL_NOTIFY,
+    AC_CALL_PERIODIC,
+    AC_CALL_DELAY_US,
+    AC_CALL_DELAY_SLACK,
     AC_CALL_MAX
 };
 
+/*
+ * Combined push/subscribe call carries two channel ids in its argument:
+ * the channel to push the owned message into in the high half and the
+ * channel to subscribe to in the low half.
+ * Select call uses the same layout: the first channel id of the set in the 
+ * high half and the mask of channels relative to it in the low half.
+ * Timed subscribe carries the timeout in ticks in the high half.
+ * Notify call carries the event bits in the high half.
+ * Delay with slack carries the slack in ticks in the high half.
+ */
+enum {
+    AC_CALL_CHAN_BITS = 14,
+    AC_CALL_CHAN_MASK = (1 << AC_CALL_CHAN_BITS) - 1,
+};
+
+/*
+ * Flag of the actor's channel set telling that the actor waits for the 
+ * event bits of a single event channel rather than selects.
+ */
+#define AC_SELECT_EVENTS (UINT32_C(1) << (AC_CALL_CHAN_BITS * 2))
+
+/*
+ * Flags of the channel set while the selecting actor polls its channels:
+ * messages and events are queued rather than delivered, the second flag 
+ * tells that some of them arrived and the set has to be polled again.
+ */
+#define AC_SELECT_POLL (UINT32_C(1) << (AC_CALL_CHAN_BITS * 2 + 1))
+#define AC_SELECT_REPOLL (UINT32_C(1) << (AC_CALL_CHAN_BITS * 2 + 2))
+
+/*
+ * Slot call argument: slot index in the low bits and the flag telling to 
+ * free the message held in the slot instead of exchanging it with the 
+ * current message.
+ */
+enum {
+    AC_CALL_SLOT_MASK = 0xff,
+    AC_CALL_SLOT_FREE = 0x100,
+};
+
+enum {
+    AC_WHEEL_SLOTS = 1 << AC_WHEEL_BITS,
+    AC_WHEEL_LEVELS = (32 + AC_WHEEL_BITS - 1) / AC_WHEEL_BITS,
+};
+
 enum {  
     AC_REGION_MSG = AC_PORT_REGIONS_NUM,
     AC_REGION_USER,
-    AC_REGIONS_NUM,
+    AC_REGION_SLOT,
+    AC_REGIONS_NUM = AC_REGION_SLOT + AC_MSG_SLOTS,
 };
 
 /*
  * There are two headers, one is used when a message isn't accessible from
  * usermode and another is used when some actor owns the message. The latter
- * contains only size as its first member.
+ * contains size and id of the channel the message was received from.
  * Poisoned message is a message that is returned to a channel by exception,
- * so its data may be invalid. Uintptr type is used to simplify ABI since
- * mg_message_t only contains pointers.
+ * so its data may be invalid. Priority is set by the sender and is used by
+ * priority-ordered channels, the link of such queues reuses the first word
+ * of the header since the message isn't in any magnesium queue then.
  */
 struct ac_message_t {
     union {
         struct mg_message_t header;
-        size_t size;
+        struct ac_message_t* next;
+        struct {
+            size_t size;
+            uintptr_t chan;
+        };
     };
-    uintptr_t poisoned;
+    uint16_t poisoned;
+    uint16_t prio;
+};
+
+/*
+ * Priority-ordered queue consists of FIFO sublists for each priority and the
+ * bitmap of nonempty ones, so both push and pop are O(1). Higher priority 
+ * messages are dequeued first.
+ */
+struct ac_prio_queue_t {
+    uint32_t bitmap;
+    struct ac_message_t* head[AC_MSG_PRIO_NUM];
+    struct ac_message_t* tail[AC_MSG_PRIO_NUM];
 };
 
 struct ac_actor_t {
@@ -51,11 +195,48 @@ struct ac_actor_t {
     uintptr_t func;
     bool restart_req;
     struct ac_channel_t* msg_parent;
+    unsigned int recv_chan;
+    uint32_t select;
+    struct ac_actor_t* wait_next;
+    struct ac_actor_t** wait_link;
+    struct ac_actor_t* timed_next;
+    struct ac_actor_t** timed_link;
+    struct ac_channel_t* msg_shared;
+    struct ac_reader_t* reader;
+    uint32_t events;
+    bool notified;
+    uint32_t period;
+    uint32_t release;
+#if AC_PORT_FPU
+    bool fpu;
+#endif
+#if AC_MSG_SLOTS
+    struct {
+        struct ac_message_t* msg;
+        struct ac_channel_t* parent;
+    } slots[AC_MSG_SLOTS];
+#endif
 };
 
+/*
+ * Loaded regions mirror the MPU state of the cpu, so switching between
+ * actors rewrites only the regions which differ. The same is for the FPU
+ * access.
+ */
 struct ac_cpu_context_t {
     struct ac_actor_t* running_actor;
+    struct ac_actor_t* timed;
     struct ac_port_region_t granted[AC_REGIONS_NUM];
+    struct ac_port_region_t loaded[AC_REGIONS_NUM + AC_PORT_MIRROR_EXTRA];
+#if AC_PORT_FPU
+    bool fpu_loaded;
+#endif
+#if !AC_TICKLESS
+    uint32_t now;
+#endif
+#if AC_TIMER_WHEEL
+    struct ac_actor_t* wheel[AC_WHEEL_LEVELS][AC_WHEEL_SLOTS];
+#endif
 
     struct {
         struct ac_port_frame_t* frame;
@@ -72,18 +253,48 @@ struct ac_context_t {
     struct ac_cpu_context_t per_cpu_data[MG_CPU_MAX];
 };
 
+/*
+ * Selector is an actor blocked on a set of channels including this one.
+ * Its id is the id of this channel used in the select call. Actors waiting 
+ * for this channel alone are queued in the FIFO list of waiters instead.
+ * Broadcast channels have reference counters for each block of the pool and
+ * the list of readers. Reader is either waiting for a message or holds the 
+ * latest one pushed while the reader was busy.
+ * Depth is the number of queued messages, it is limited for bounded ones.
+ * Event channels carry no messages, only the word of event bits.
+ */
 struct ac_channel_t {
     struct mg_message_pool_t base;
+    struct ac_actor_t* selector;
+    unsigned int selector_id;
+    struct ac_actor_t* waiters;
+    struct ac_reader_t* readers;
+    uint8_t* refs;
+    struct ac_prio_queue_t* prioq;
+    unsigned int depth;
+    unsigned int limit;
+    uint32_t events;
+    bool is_event;
+};
+
+struct ac_reader_t {
+    struct ac_reader_t* next;
+    struct ac_actor_t* actor;
+    struct ac_message_t* pending;
 };
 
 _Static_assert(offsetof(struct ac_message_t, header) == 0, "non 1st member");
 _Static_assert(offsetof(struct ac_actor_t, base) == 0, "non 1st member");
 _Static_assert(offsetof(struct ac_channel_t, base) == 0, "non 1st member");
 _Static_assert(sizeof(struct ac_message_t) == sizeof(uintptr_t) * 3, "pad");
+_Static_assert(AC_MSG_SLOTS <= AC_PORT_REGIONS_MAX - AC_REGION_SLOT,
+    "too many msg slots");
+_Static_assert(AC_MSG_PRIO_NUM <= 32, "too many msg priorities");
 
 extern noreturn void ac_kernel_start(void);
 extern void* ac_intr_handler(uint32_t vect, void* frame);
 extern void* ac_svc_handler(uint32_t arg, void* frame);
+extern void* ac_svc_handoff(void* frame);
 extern void* ac_trap_handler(uint32_t exception_id);
 extern void ac_actor_error(struct ac_actor_t* src);
 extern struct ac_channel_t* ac_channel_validate(
@@ -92,100 +303,949 @@ extern struct ac_channel_t* ac_channel_validate(
     bool is_write
 );
 
-extern struct ac_context_t g_ac_context;
-#define AC_GET_CONTEXT() (&(g_ac_context.per_cpu_data[mg_cpu_this()]))
+/*
+ * Tickless mode hooks. The first one returns the number of ticks since the
+ * start, the second one programs the one-shot timer interrupt at the given
+ * tick, the deadline in the past fires right away. Both are called within
+ * the critical section. The timer interrupt handler calls ac_context_tick.
+ * With AC_TIMER_US the time is in microseconds. The kernel uses the low word
+ * of the time only, so the port extends the deadline to its own counter 
+ * as the nearest value to the current time.
+ */
+#if AC_TICKLESS
+extern uint32_t ac_port_timer_now(void);
+extern void ac_port_timer_set(uint32_t deadline);
+extern void ac_port_timer_stop(void);
+#endif
+
+extern struct ac_context_t g_ac_context;
+#define AC_GET_CONTEXT() (&(g_ac_context.per_cpu_data[mg_cpu_this()]))
+
+static inline void ac_context_init(void) {
+    if (mg_cpu_this() == 0) {
+        mg_context_init();
+    }
+
+    struct ac_cpu_context_t* const context = AC_GET_CONTEXT();
+    context->timed = 0;
+    ac_port_init(AC_REGIONS_NUM, context->granted);
+
+    for (unsigned int i = 0; i < AC_REGIONS_NUM; ++i) {
+        context->loaded[i] = context->granted[i];
+    }
+
+    for (unsigned int i = AC_REGIONS_NUM; i < AC_REGIONS_NUM + AC_PORT_MIRROR_EXTRA; ++i) {
+        ac_port_region_init(&context->loaded[i], 0, 0, AC_ATTR_RW);
+    }
+
+#if AC_PORT_FPU
+    context->fpu_loaded = false;
+#endif
+#if !AC_TICKLESS
+    context->now = 0;
+#endif
+#if AC_TIMER_WHEEL
+    for (unsigned int i = 0; i < AC_WHEEL_LEVELS; ++i) {
+        for (unsigned int j = 0; j < AC_WHEEL_SLOTS; ++j) {
+            context->wheel[i][j] = 0;
+        }
+    }
+#endif
+}
+
+static inline void _ac_mpu_load(const struct ac_port_region_t* regions) {
+    struct ac_cpu_context_t* const context = AC_GET_CONTEXT();
+    ac_port_mpu_update(AC_REGIONS_NUM, context->loaded, regions);
+}
+
+/*
+ * Grants FPU access to the actor with the FPU flag, null means idle-loop.
+ */
+static inline void _ac_fpu_load(const struct ac_actor_t* actor) {
+#if AC_PORT_FPU
+    struct ac_cpu_context_t* const context = AC_GET_CONTEXT();
+    const bool enabled = actor && actor->fpu;
+
+    if (context->fpu_loaded != enabled) {
+        context->fpu_loaded = enabled;
+        ac_port_fpu_grant(enabled);
+    }
+#else
+    (void) actor;
+#endif
+}
+
+/*
+ * Pending lazy save of the FP registers uses the MPU regions loaded at the 
+ * moment, so it is triggered before the switch to another actor and dropped
+ * when the actor completes. Entries which switch nothing don't save them.
+ */
+static inline void _ac_fpu_lazy_save(void) {
+#if AC_PORT_FPU
+    ac_port_fpu_lazy_save();
+#endif
+}
+
+static inline void _ac_fpu_lazy_drop(void) {
+#if AC_PORT_FPU
+    ac_port_fpu_lazy_drop();
+#endif
+}
+
+static inline void _ac_timed_tick(void);
+
+/*
+ * Tickless kernel doesn't use magnesium timers, so delays of privileged 
+ * actors are unavailable.
+ */
+static inline void ac_context_tick(void) {
+#if !AC_TICKLESS
+    mg_context_tick();
+#endif
+    _ac_timed_tick();
+}
+
+static inline void ac_context_stack_set(unsigned prio, size_t sz, void* ptr) {
+    struct ac_cpu_context_t* const context = AC_GET_CONTEXT();
+    assert((sz & (sz - 1)) == 0);
+    assert(sz > sizeof(struct ac_port_frame_t));
+    context->stacks[prio].top = (uintptr_t) ptr + sz;
+    context->stacks[prio].size = sz;
+}
+
+static inline void ac_channel_init_ex(
+    struct ac_channel_t* chan, 
+    size_t total_len,
+    void* mem,
+    size_t block_sz
+) {
+    assert((block_sz & (block_sz - 1)) == 0);
+    assert((((uintptr_t)mem) & (block_sz - 1)) == 0);
+    mg_queue_init(&chan->base.queue);
+    chan->base.array = mem;
+    chan->base.total_length = total_len;
+    chan->base.block_sz = block_sz;
+    chan->base.offset = 0;
+    chan->base.array_space_available = (total_len != 0);
+    chan->selector = 0;
+    chan->selector_id = 0;
+    chan->waiters = 0;
+    chan->readers = 0;
+    chan->refs = 0;
+    chan->prioq = 0;
+    chan->depth = 0;
+    chan->limit = 0;
+    chan->events = 0;
+    chan->is_event = false;
+
+    for (size_t i = 0; i < total_len; i += block_sz) {
+        struct ac_message_t* const msg = (void*) ((uint8_t*) mem + i);
+        msg->poisoned = 0;
+        msg->prio = 0;
+    }
+}
+
+static inline void ac_channel_init(struct ac_channel_t* chan) {
+    ac_channel_init_ex(chan, 0, 0, 0);
+}
+
+/*
+ * Event channel is a word of event bits which are ORed by notifications and
+ * are taken all at once by the actor. Neither message allocation nor MPU 
+ * update is needed, so it is intended for interrupt notifications.
+ */
+static inline void ac_channel_init_event(struct ac_channel_t* chan) {
+    ac_channel_init_ex(chan, 0, 0, 0);
+    chan->is_event = true;
+}
+
+/*
+ * Broadcast channel is a pool which fans out pushed messages to all of its
+ * readers. Refs array must contain a counter for each block of the pool.
+ */
+static inline void ac_channel_init_broadcast(
+    struct ac_channel_t* chan, 
+    size_t total_len,
+    void* mem,
+    size_t block_sz,
+    uint8_t* refs
+) {
+    assert(refs != 0);
+    ac_channel_init_ex(chan, total_len, mem, block_sz);
+    chan->refs = refs;
+}
+
+/*
+ * Priority-ordered channel. Ids of such channels must fit into the select
+ * call argument since waiting on them is implemented as select.
+ */
+static inline void ac_channel_init_prio(
+    struct ac_channel_t* chan, 
+    size_t total_len,
+    void* mem,
+    size_t block_sz,
+    struct ac_prio_queue_t* queue
+) {
+    ac_channel_init_ex(chan, total_len, mem, block_sz);
+    queue->bitmap = 0;
+
+    for (unsigned int i = 0; i < AC_MSG_PRIO_NUM; ++i) {
+        queue->head[i] = 0;
+        queue->tail[i] = 0;
+    }
+
+    chan->prioq = queue;
+}
+
+static inline void _ac_prio_push(
+    struct ac_prio_queue_t* queue, 
+    struct ac_message_t* msg
+) {
+    const unsigned int i = (msg->prio < AC_MSG_PRIO_NUM) ? 
+        msg->prio : (AC_MSG_PRIO_NUM - 1);
+    msg->next = 0;
+
+    if (queue->head[i]) {
+        queue->tail[i]->next = msg;
+    } else {
+        queue->head[i] = msg;
+        queue->bitmap |= UINT32_C(1) << i;
+    }
+
+    queue->tail[i] = msg;
+}
+
+static inline struct ac_message_t* _ac_prio_pop(struct ac_prio_queue_t* queue) {
+    struct ac_message_t* msg = 0;
+
+    if (queue->bitmap) {
+        const unsigned int i = 31 - mg_port_clz(queue->bitmap);
+        msg = queue->head[i];
+        queue->head[i] = msg->next;
+
+        if (queue->head[i] == 0) {
+            queue->bitmap &= ~(UINT32_C(1) << i);
+        }
+    }
+
+    return msg;
+}
+
+/*
+ * Bounded channel rejects pushes when the limit of queued messages is 
+ * reached. Pools cannot be bounded since freeing a message never fails.
+ * Subscribers of bounded channels wait the same way as select does.
+ */
+static inline void ac_channel_limit_set(
+    struct ac_channel_t* chan, 
+    unsigned int limit
+) {
+    assert(chan->base.total_length == 0);
+    assert(chan->refs == 0);
+    chan->limit = limit;
+}
+
+static inline void ac_channel_reader_add(
+    struct ac_channel_t* chan,
+    struct ac_reader_t* reader,
+    struct ac_actor_t* actor
+) {
+    assert(chan->refs != 0);
+    reader->actor = actor;
+    reader->pending = 0;
+    reader->next = chan->readers;
+    chan->readers = reader;
+}
+
+static inline void _ac_message_bind(struct ac_actor_t* actor) {
+    struct ac_message_t* const msg = (void*) actor->base.mailbox;
+    const bool not_bound = actor->msg_parent == 0;
+
+    if (msg && not_bound) {
+        struct ac_channel_t* const shared = actor->msg_shared;
+        struct ac_channel_t* const parent = shared ? shared : (void*) msg->header.parent;
+        struct ac_port_region_t* const region = &actor->granted[AC_REGION_MSG];       
+        const unsigned int attr = shared ? AC_ATTR_RO : AC_ATTR_RW;
+        actor->msg_parent = parent;
+        msg->size = parent->base.block_sz;
+        msg->chan = actor->recv_chan;
+        ac_port_region_init(region, (uintptr_t)msg, msg->size, attr);
+    }
+}
+
+static inline void _ac_message_unbind(struct ac_actor_t* actor) {
+    struct ac_message_t* const msg = (void*) actor->base.mailbox;
+    assert(msg != 0);
+
+    if (actor->msg_shared == 0) {
+        msg->header.parent = &actor->msg_parent->base;
+    }
+
+    actor->base.mailbox = 0;
+    actor->msg_parent = 0;
+    actor->msg_shared = 0;
+    ac_port_region_init(&actor->granted[AC_REGION_MSG], 0, 0, AC_ATTR_RW);
+}
+
+/*
+ * Actor is started with either the owned message or the event bits taken
+ * by the last call.
+ */
+static inline void* _ac_actor_arg(struct ac_actor_t* actor) {
+    if (actor->notified) {
+        actor->notified = false;
+        return (void*) (uintptr_t) actor->events;
+    }
+
+    return actor->base.mailbox;
+}
+
+/*
+ * Actors waiting for a message with the timeout and periodic actors are 
+ * linked into the per-cpu list. The countdown is kept in the timeout member of the base actor since
+ * magnesium doesn't use it until the actor is delayed. Magnesium timers 
+ * cannot be used for this because the actor's link would be held by the 
+ * timer queue while the message may activate the actor at any moment.
+ * In tickless mode delayed actors are linked into the same list, the list is
+ * sorted by the deadline tick kept in the timeout member, so the timer is 
+ * programmed by the head. The deadline is the tick the countdown would be 
+ * expired at, so timing is the same as in the ticked mode.
+ * Timeouts are armed at the absolute tick, it is the port timer in tickless
+ * mode and the count of ticks of the cpu otherwise.
+ */
+static inline void _ac_timed_link(
+    struct ac_actor_t* actor, 
+    struct ac_actor_t** link
+) {
+    struct ac_actor_t* const next = *link;
+    actor->timed_next = next;
+    actor->timed_link = link;
+
+    if (next) {
+        next->timed_link = &actor->timed_next;
+    }
+
+    *link = actor;
+}
+
+static inline bool _ac_time_before(uint32_t a, uint32_t b) {
+    return (int32_t) (a - b) < 0;
+}
+
+/*
+ * Conversions of delays to the units of the timed list: ticks or the port
+ * timer units when it counts microseconds. Delays are clamped to the half
+ * of the timer range which deadlines are compared within.
+ */
+#define AC_TIMED_MAX ((uint32_t) INT32_MAX)
+
+static inline uint32_t _ac_timed_ticks(uint32_t ticks) {
+#if AC_TIMER_US
+    return (ticks <= AC_TIMED_MAX / AC_TICK_US) ? ticks * AC_TICK_US : AC_TIMED_MAX;
+#else
+    return (ticks <= AC_TIMED_MAX) ? ticks : AC_TIMED_MAX;
+#endif
+}
+
+static inline uint32_t _ac_timed_us(uint32_t us) {
+#if AC_TIMER_US
+    return (us <= AC_TIMED_MAX) ? us : AC_TIMED_MAX;
+#else
+    return (us + AC_TICK_US - 1) / AC_TICK_US;
+#endif
+}
+
+/*
+ * Expiration tick is moved within the slack to the tick with the most lower
+ * zero bits, so the timeouts of close deadlines land on the same tick and
+ * expire as a single batch. It is the end of the window with the bits below
+ * the highest one differing from the tick before the deadline cleared.
+ */
+static inline uint32_t _ac_timed_coalesce(uint32_t deadline, uint32_t slack) {
+    const uint32_t last = deadline + slack;
+    const unsigned int bit = 31 - mg_port_clz((deadline - 1) ^ last);
+    return last & ~((UINT32_C(1) << bit) - 1);
+}
+
+static inline uint32_t _ac_timed_now(const struct ac_cpu_context_t* context) {
+#if AC_TICKLESS
+    (void) context;
+    return ac_port_timer_now();
+#else
+    return context->now;
+#endif
+}
+
+#if AC_TIMER_WHEEL
+/*
+ * Wheel level is chosen by the highest group of bits where the expiration
+ * tick differs from the current one. Actors of the slot are moved to lower
+ * levels when the current tick reaches the start of the slot.
+ */
+static inline struct ac_actor_t** _ac_wheel_slot(
+    struct ac_cpu_context_t* context, 
+    uint32_t expires
+) {
+    const uint32_t diff = (expires ^ context->now) | 1;
+    const unsigned int level = (31 - mg_port_clz(diff)) / AC_WHEEL_BITS;
+    const unsigned int slot = (expires >> (level * AC_WHEEL_BITS)) & (AC_WHEEL_SLOTS - 1);
+    return &context->wheel[level][slot];
+}
+
+static inline void _ac_timed_arm_at(struct ac_actor_t* actor, uint32_t expires) {
+    struct ac_cpu_context_t* const context = AC_GET_CONTEXT();
+    actor->base.timeout = expires;
+    _ac_timed_link(actor, _ac_wheel_slot(context, expires));
+}
+#elif AC_TICKLESS
+static inline void _ac_timed_arm_at(struct ac_actor_t* actor, uint32_t deadline) {
+    struct ac_cpu_context_t* const context = AC_GET_CONTEXT();
+    struct ac_actor_t** link = &context->timed;
+
+    while (*link && !_ac_time_before(deadline, (*link)->base.timeout)) {
+        link = &(*link)->timed_next;
+    }
+
+    actor->base.timeout = deadline;
+    _ac_timed_link(actor, link);
+
+    if (context->timed == actor) {
+        ac_port_timer_set(deadline);
+    }
+}
+#else
+static inline void _ac_timed_arm_at(struct ac_actor_t* actor, uint32_t deadline) {
+    struct ac_cpu_context_t* const context = AC_GET_CONTEXT();
+    actor->base.timeout = deadline - context->now;
+    _ac_timed_link(actor, &context->timed);
+}
+#endif
+
+static inline void _ac_timed_arm(struct ac_actor_t* actor, uint32_t ticks) {
+    _ac_timed_arm_at(actor, _ac_timed_now(AC_GET_CONTEXT()) + _ac_timed_ticks(ticks));
+}
+
+static inline void _ac_timed_disarm(struct ac_actor_t* actor) {
+    struct ac_actor_t* const next = actor->timed_next;
+
+    if (actor->timed_link) {
+        *actor->timed_link = next;
+
+        if (next) {
+            next->timed_link = actor->timed_link;
+        }
+
+        actor->timed_link = 0;
+    }
+}
+
+/*
+ * Waiters are appended to the tail, so the channel wakes them in the order
+ * they started to wait. Both functions must be called from the critical 
+ * section.
+ */
+static inline void _ac_waiter_add(
+    struct ac_channel_t* chan, 
+    struct ac_actor_t* actor
+) {
+    struct ac_actor_t** link = &chan->waiters;
+
+    while (*link) {
+        link = &(*link)->wait_next;
+    }
+
+    actor->wait_next = 0;
+    actor->wait_link = link;
+    *link = actor;
+}
+
+static inline void _ac_waiter_remove(struct ac_actor_t* actor) {
+    if (actor->wait_link) {
+        struct ac_actor_t* const next = actor->wait_next;
+        *actor->wait_link = next;
+
+        if (next) {
+            next->wait_link = actor->wait_link;
+        }
+
+        actor->wait_link = 0;
+    }
+}
+
+/*
+ * Channel set of the actor is processed in the critical section since a 
+ * message may be pushed into any of them by an interrupt handler. The wait
+ * timeout, if any, is cancelled along with the set.
+ */
+static inline void _ac_select_cancel(struct ac_actor_t* actor) {
+    const unsigned int base = (actor->select >> AC_CALL_CHAN_BITS) & AC_CALL_CHAN_MASK;
+    uint32_t mask = actor->select & AC_CALL_CHAN_MASK;
+    actor->select = 0;
+    actor->reader = 0;
+    _ac_timed_disarm(actor);
+    _ac_waiter_remove(actor);
+
+    while (mask) {
+        const unsigned int i = 31 - mg_port_clz(mask);
+        struct ac_channel_t* const chan = ac_channel_validate(actor, base + i, false);
+        mask &= ~(UINT32_C(1) << i);
+
+        if (chan && chan->selector == actor) {
+            chan->selector = 0;
+        }
+    }
+}
+
+/*
+ * Expired wait is cancelled along with the channel set and the actor is
+ * started with no message. Delayed actors keep their message like magnesium
+ * timers do.
+ */
+static inline void _ac_timed_expire(struct ac_actor_t* actor) {
+    if (actor->select) {
+        _ac_select_cancel(actor);
+        actor->base.mailbox = 0;
+    } else {
+        _ac_timed_disarm(actor);
+    }
+}
+
+/*
+ * Shared message is returned into the pool of its broadcast channel when
+ * the last reference is dropped. Its header is restored since readers have
+ * overwritten it while binding.
+ */
+static inline void _ac_broadcast_unref(
+    struct ac_channel_t* chan, 
+    struct ac_message_t* msg
+) {
+    const size_t i = ((uintptr_t) msg - (uintptr_t) chan->base.array) / chan->base.block_sz;
+    mg_critical_section_enter();
+    const unsigned int refs = --chan->refs[i];
+    mg_critical_section_leave();
+
+    if (refs == 0) {
+        msg->header.parent = &chan->base;
+        msg->poisoned = 0;
+        msg->prio = 0;
+        mg_queue_push(&chan->base.queue, &msg->header);
+    }
+}
+
+/*
+ * Each reader takes a reference to the message. Waiting readers are 
+ * activated, busy ones get the message as pending replacing the previous 
+ * one, so slow readers see only the latest message. The push itself holds a
+ * reference until all the readers are processed.
+ */
+static inline void _ac_broadcast(
+    struct ac_channel_t* chan, 
+    struct ac_message_t* msg
+) {
+    const size_t i = ((uintptr_t) msg - (uintptr_t) chan->base.array) / chan->base.block_sz;
+    chan->refs[i] = 1;
+
+    for (struct ac_reader_t* r = chan->readers; r != 0; r = r->next) {
+        struct ac_actor_t* const actor = r->actor;
+        struct ac_message_t* dropped = 0;
+        mg_critical_section_enter();
+        const bool waiting = (actor->reader == r);
+        ++chan->refs[i];
+
+        if (waiting) {
+            _ac_select_cancel(actor);
+        } else {
+            dropped = r->pending;
+            r->pending = msg;
+        }
+
+        mg_critical_section_leave();
+
+        if (waiting) {
+            actor->msg_shared = chan;
+            actor->base.mailbox = &msg->header;
+            _mg_actor_activate(&actor->base);
+        } else if (dropped) {
+            _ac_broadcast_unref(chan, dropped);
+        }
+    }
+
+    _ac_broadcast_unref(chan, msg);
+}
+
+/*
+ * Returns the actor waiting for the channel: the selector, otherwise the 
+ * first waiter. The actor which is polling its channel set is not returned
+ * but told to poll again. Must be called from the critical section.
+ */
+static inline struct ac_actor_t* _ac_channel_selector(struct ac_channel_t* chan) {
+    struct ac_actor_t* const actor = chan->selector ? chan->selector : chan->waiters;
+
+    if (actor && (actor->select & AC_SELECT_POLL)) {
+        actor->select |= AC_SELECT_REPOLL;
+        return 0;
+    }
+
+    if (actor && (actor == chan->selector)) {
+        actor->recv_chan = chan->selector_id;
+    }
+
+    return actor;
+}
+
+/*
+ * Kernel-side push. Message pushed into a channel which is a member of some
+ * actor's channel set is delivered to that actor directly, otherwise the 
+ * message is queued. Interrupt handlers must use this function to feed 
+ * channels which may be selected. Broadcast channels accept only messages
+ * allocated from their own pools, others are freed.
+ * Returns false if the bounded channel is full, the message is not consumed
+ * then.
+ */
+static inline bool ac_channel_push(
+    struct ac_channel_t* chan, 
+    struct ac_message_t* msg
+) {
+    if (chan->refs) {
+        if (msg->header.parent == &chan->base) {
+            _ac_broadcast(chan, msg);
+        } else {
+            mg_message_free(&msg->header);
+        }
+
+        return true;
+    }
+
+    if (chan->is_event) {
+        return false;
+    }
+
+    mg_critical_section_enter();
+    struct ac_actor_t* const actor = _ac_channel_selector(chan);
+    const bool accepted = actor || (chan->limit == 0) || (chan->depth < chan->limit);
+
+    if (actor) {
+        _ac_select_cancel(actor);
+    } else if (accepted) {
+        chan->depth += (chan->limit != 0);
+
+        if (chan->prioq) {
+            _ac_prio_push(chan->prioq, msg);
+        }
+    }
+
+    mg_critical_section_leave();
+
+    if (actor) {
+        actor->base.mailbox = &msg->header;
+        _mg_actor_activate(&actor->base);
+    } else if (accepted && (chan->prioq == 0)) {
+        mg_queue_push(&chan->base.queue, &msg->header);
+    }
+
+    return accepted;
+}
+
+/*
+ * ORs the bits into the event channel. The actor waiting for the events of 
+ * this channel takes them all, the actor which selects the channel is 
+ * activated with no message and takes the events by polling. Otherwise bits
+ * are coalesced until the next wait.
+ */
+static inline void ac_channel_notify(struct ac_channel_t* chan, uint32_t bits) {
+    assert(chan->is_event);
+
+    if (bits == 0) {
+        return;
+    }
+
+    mg_critical_section_enter();
+    struct ac_actor_t* const actor = _ac_channel_selector(chan);
+    chan->events |= bits;
+
+    if (actor) {
+        if (actor->select & AC_SELECT_EVENTS) {
+            actor->events = chan->events;
+            actor->notified = true;
+            chan->events = 0;
+        }
+
+        _ac_select_cancel(actor);
+    }
+
+    mg_critical_section_leave();
+
+    if (actor) {
+        _mg_actor_activate(&actor->base);
+    }
+}
+
+/*
+ * Takes a message from the channel without subscription: initial pool 
+ * blocks go first, then queued messages.
+ */
+static inline struct ac_message_t* _ac_channel_poll(struct ac_channel_t* chan) {
+    struct ac_message_t* msg = mg_message_alloc(&chan->base);
+
+    if (msg == 0 && chan->prioq) {
+        mg_critical_section_enter();
+        msg = _ac_prio_pop(chan->prioq);
+        mg_critical_section_leave();
+    } else if (msg == 0) {
+        msg = (void*) mg_queue_pop(&chan->base.queue, 0);
+    }
+
+    /* Bounded channels have no pool so any message is a queued one. */
+    if (msg && chan->limit) {
+        mg_critical_section_enter();
+        --chan->depth;
+        mg_critical_section_leave();
+    }
+
+    return msg;
+}
+
+/*
+ * Expired waits are cancelled in the critical section, then the actors are 
+ * activated with no message which indicates the timeout.
+ * Timer wheel cascades the slots of upper levels starting at the current 
+ * tick, then expires the current slot of the lowest level.
+ * In tickless mode expired actors are taken from the head of the list and
+ * the timer is reprogrammed for the next one.
+ */
+#if AC_TIMER_WHEEL
+static inline void _ac_timed_tick(void) {
+    struct ac_cpu_context_t* const context = AC_GET_CONTEXT();
+    struct ac_actor_t* expired = 0;
+    struct ac_actor_t** tail = &expired;
+    mg_critical_section_enter();
+    const uint32_t now = ++context->now;
+
+    for (unsigned int level = 1; level < AC_WHEEL_LEVELS; ++level) {
+        const unsigned int shift = level * AC_WHEEL_BITS;
 
-static inline void ac_context_init(void) {
-    if (mg_cpu_this() == 0) {
-        mg_context_init();
+        if (now & ((UINT32_C(1) << shift) - 1)) {
+            break;
+        }
+
+        struct ac_actor_t** const slot = &context->wheel[level][(now >> shift) & (AC_WHEEL_SLOTS - 1)];
+        struct ac_actor_t* actor = *slot;
+        *slot = 0;
+
+        while (actor) {
+            struct ac_actor_t* const next = actor->timed_next;
+            _ac_timed_link(actor, _ac_wheel_slot(context, actor->base.timeout));
+            actor = next;
+        }
     }
 
-    struct ac_cpu_context_t* const context = AC_GET_CONTEXT();
-    ac_port_init(AC_REGIONS_NUM, context->granted);
-}
+    struct ac_actor_t** const slot = &context->wheel[0][now & (AC_WHEEL_SLOTS - 1)];
 
-static inline void ac_context_tick(void) {
-    mg_context_tick();
-}
+    while (*slot) {
+        struct ac_actor_t* const actor = *slot;
+        _ac_timed_expire(actor);
+        *tail = actor;
+        tail = &actor->timed_next;
+    }
 
-static inline void ac_context_stack_set(unsigned prio, size_t sz, void* ptr) {
-    struct ac_cpu_context_t* const context = AC_GET_CONTEXT();
-    assert((sz & (sz - 1)) == 0);
-    assert(sz > sizeof(struct ac_port_frame_t));
-    context->stacks[prio].top = (uintptr_t) ptr + sz;
-    context->stacks[prio].size = sz;
-}
+    *tail = 0;
+    mg_critical_section_leave();
 
-static inline void ac_channel_init_ex(
-    struct ac_channel_t* chan, 
-    size_t total_len,
-    void* mem,
-    size_t block_sz
-) {
-    assert((block_sz & (block_sz - 1)) == 0);
-    assert((((uintptr_t)mem) & (block_sz - 1)) == 0);
-    mg_queue_init(&chan->base.queue);
-    chan->base.array = mem;
-    chan->base.total_length = total_len;
-    chan->base.block_sz = block_sz;
-    chan->base.offset = 0;
-    chan->base.array_space_available = (total_len != 0);
+    while (expired) {
+        struct ac_actor_t* const actor = expired;
+        expired = actor->timed_next;
+        _mg_actor_activate(&actor->base);
+    }
 }
+#elif AC_TICKLESS
+static inline void _ac_timed_tick(void) {
+    struct ac_cpu_context_t* const context = AC_GET_CONTEXT();
+    struct ac_actor_t* expired = 0;
+    struct ac_actor_t** tail = &expired;
+    mg_critical_section_enter();
+    const uint32_t now = ac_port_timer_now();
 
-static inline void ac_channel_init(struct ac_channel_t* chan) {
-    ac_channel_init_ex(chan, 0, 0, 0);
+    while (context->timed && !_ac_time_before(now, context->timed->base.timeout)) {
+        struct ac_actor_t* const actor = context->timed;
+        _ac_timed_expire(actor);
+        *tail = actor;
+        tail = &actor->timed_next;
+    }
+
+    *tail = 0;
+
+    if (context->timed) {
+        ac_port_timer_set(context->timed->base.timeout);
+    } else {
+        ac_port_timer_stop();
+    }
+
+    mg_critical_section_leave();
+
+    while (expired) {
+        struct ac_actor_t* const actor = expired;
+        expired = actor->timed_next;
+        _mg_actor_activate(&actor->base);
+    }
 }
+#else
+static inline void _ac_timed_tick(void) {
+    struct ac_cpu_context_t* const context = AC_GET_CONTEXT();
+    struct ac_actor_t* expired = 0;
+    mg_critical_section_enter();
+    ++context->now;
 
-static inline void _ac_message_bind(struct ac_actor_t* actor) {
-    struct ac_message_t* const msg = (void*) actor->base.mailbox;
-    const bool not_bound = actor->msg_parent == 0;
+    for (struct ac_actor_t* actor = context->timed; actor != 0; ) {
+        struct ac_actor_t* const next = actor->timed_next;
 
-    if (msg && not_bound) {
-        struct ac_channel_t* const parent = (void*) msg->header.parent;
-        struct ac_port_region_t* const region = &actor->granted[AC_REGION_MSG];       
-        actor->msg_parent = parent;
-        msg->size = parent->base.block_sz;
-        ac_port_region_init(region, (uintptr_t)msg, msg->size, AC_ATTR_RW);
+        if (--actor->base.timeout == 0) {
+            _ac_timed_expire(actor);
+            actor->timed_next = expired;
+            expired = actor;
+        }
+
+        actor = next;
+    }
+
+    mg_critical_section_leave();
+
+    while (expired) {
+        struct ac_actor_t* const actor = expired;
+        expired = actor->timed_next;
+        _mg_actor_activate(&actor->base);
     }
 }
+#endif
 
-static inline void _ac_message_unbind(struct ac_actor_t* actor) {
-    struct ac_message_t* const msg = (void*) actor->base.mailbox;
-    assert(msg != 0);
-    msg->header.parent = &actor->msg_parent->base;
-    actor->base.mailbox = 0;
-    actor->msg_parent = 0;
-    ac_port_region_init(&actor->granted[AC_REGION_MSG], 0, 0, AC_ATTR_RW);
+/*
+ * Queue of the broadcast channel contains only free blocks since pushed 
+ * messages are fanned out.
+ */
+static inline void _ac_message_free(
+    struct ac_channel_t* parent, 
+    struct ac_message_t* msg
+) {
+    if (parent->refs) {
+        mg_queue_push(&parent->base.queue, &msg->header);
+    } else {
+        ac_channel_push(parent, msg);
+    }
 }
 
 static inline void _ac_message_release(struct ac_actor_t* actor, bool poisoned) {
     struct ac_message_t* const msg = (void*) actor->base.mailbox;
 
     if (msg) {
+        struct ac_channel_t* const parent = actor->msg_parent;
+        const bool shared = (actor->msg_shared != 0);
         _ac_message_unbind(actor);
+
+        if (shared) {
+            _ac_broadcast_unref(parent, msg);
+        } else {
+            msg->poisoned = poisoned;
+            msg->prio = 0;
+            _ac_message_free(parent, msg);
+        }
+    }
+}
+
+/*
+ * Messages held in slots stay bound, their regions are the part of the
+ * granted ones, so only the parent is saved like for the current message.
+ */
+#if AC_MSG_SLOTS
+static inline void _ac_slot_release(
+    struct ac_actor_t* actor, 
+    unsigned int i, 
+    bool poisoned
+) {
+    struct ac_message_t* const msg = actor->slots[i].msg;
+    struct ac_channel_t* const parent = actor->slots[i].parent;
+
+    if (msg) {
+        msg->header.parent = &parent->base;
         msg->poisoned = poisoned;
-        mg_message_free(&msg->header);
+        actor->slots[i].msg = 0;
+        actor->slots[i].parent = 0;
+        ac_port_region_init(&actor->granted[AC_REGION_SLOT + i], 0, 0, AC_ATTR_RW);
+        _ac_message_free(parent, msg);
+    }
+}
+
+static inline void _ac_slot_swap(struct ac_actor_t* actor, unsigned int i) {
+    struct ac_message_t* const msg = actor->slots[i].msg;
+    struct ac_channel_t* const parent = actor->slots[i].parent;
+    actor->slots[i].msg = (void*) actor->base.mailbox;
+    actor->slots[i].parent = actor->msg_parent;
+    actor->base.mailbox = (void*) msg;
+    actor->msg_parent = parent;
+    ac_port_region_swap(
+        &actor->granted[AC_REGION_SLOT + i], 
+        &actor->granted[AC_REGION_MSG]
+    );
+}
+#endif
+
+static inline void _ac_slots_init(struct ac_actor_t* actor) {
+#if AC_MSG_SLOTS
+    for (unsigned int i = 0; i < AC_MSG_SLOTS; ++i) {
+        actor->slots[i].msg = 0;
+        actor->slots[i].parent = 0;
+        ac_port_region_init(&actor->granted[AC_REGION_SLOT + i], 0, 0, AC_ATTR_RW);
+    }
+#endif
+}
+
+static inline void _ac_slots_release(struct ac_actor_t* actor, bool poisoned) {
+#if AC_MSG_SLOTS
+    for (unsigned int i = 0; i < AC_MSG_SLOTS; ++i) {
+        _ac_slot_release(actor, i, poisoned);
     }
+#endif
 }
 
-static inline void _ac_channel_push(
+/*
+ * Returns false when the message remains owned: either the channel is full
+ * or the message is shared, shared messages are read-only for readers so 
+ * they can't be forwarded.
+ */
+static inline bool _ac_channel_push(
     struct ac_actor_t* src, 
     struct ac_channel_t* dst
 ) {
     struct ac_message_t* const msg = (void*) src->base.mailbox;
 
-    if (msg) {
-        msg->poisoned = 0;
-        _ac_message_unbind(src);
-        mg_queue_push(&dst->base.queue, &msg->header);
+    if (msg == 0) {
+        return true;
+    }
+
+    if (src->msg_shared) {
+        return false;
+    }
+
+    msg->poisoned = 0;
+    _ac_message_unbind(src);
+
+    if (!ac_channel_push(dst, msg)) {
+        src->base.mailbox = &msg->header;
+        _ac_message_bind(src);
+        return false;
     }
+
+    return true;
 }
 
+/*
+ * Only actors with the FPU flag may use the hardware FPU, the flag is 
+ * ignored unless the kernel is built with AC_PORT_FPU.
+ */
 struct ac_actor_descr_t {
     uintptr_t flash_addr;
     size_t flash_size;
     uintptr_t sram_addr; 
     size_t sram_size;
+    bool fpu;
 };
 
 static inline void ac_actor_init(
@@ -198,7 +1258,23 @@ static inline void ac_actor_init(
     actor->func = descr->flash_addr;
     actor->restart_req = true;
     actor->msg_parent = 0;
+    actor->recv_chan = 0;
+    actor->select = 0;
+    actor->wait_next = 0;
+    actor->wait_link = 0;
+    actor->timed_next = 0;
+    actor->timed_link = 0;
+    actor->msg_shared = 0;
+    actor->reader = 0;
+    actor->events = 0;
+    actor->notified = false;
+    actor->period = 0;
+    actor->release = 0;
+#if AC_PORT_FPU
+    actor->fpu = descr->fpu;
+#endif
     struct ac_cpu_context_t* const context = AC_GET_CONTEXT();
+    ac_port_region_ids_init(AC_REGIONS_NUM, regions);
 
     ac_port_region_init(
         &regions[AC_PORT_REGION_FLASH], 
@@ -220,6 +1296,7 @@ static inline void ac_actor_init(
         AC_ATTR_RW
     );
     ac_port_region_init(&regions[AC_REGION_MSG], 0, 0, AC_ATTR_RW);
+    _ac_slots_init(actor);
     _mg_actor_activate(&actor->base);
 }
 
@@ -271,14 +1348,16 @@ static inline struct ac_port_frame_t* _ac_intr_handler(
             struct ac_actor_t* const actor = (struct ac_actor_t*) next;
             const unsigned int prio = actor->base.prio;
 
+            _ac_fpu_lazy_save();
             context->preempted[prio].frame = frame;
             context->preempted[prio].actor = context->running_actor;
             context->running_actor = actor;
             frame = _ac_frame_create(actor);
             ac_port_level_mask(prio);
             _ac_message_bind(actor);
-            ac_port_mpu_reprogram(AC_REGIONS_NUM, actor->granted);
-            ac_port_frame_set_arg(frame, actor->base.mailbox);
+            _ac_mpu_load(actor->granted);
+            _ac_fpu_load(actor);
+            ac_port_frame_set_arg(frame, _ac_actor_arg(actor));
 
             if (!last) {
                 pic_interrupt_request(mg_cpu_this(), vect);
@@ -298,22 +1377,30 @@ static inline struct ac_port_frame_t* _ac_frame_restore_prev(void) {
     struct ac_port_frame_t* prev_frame = context->preempted[my_prio].frame;
 
     assert(me != 0);
+    _ac_fpu_lazy_drop();
     context->preempted[my_prio].frame = 0;
     context->preempted[my_prio].actor = 0;
     context->running_actor = prev;
 
     if (prev == 0) {       /* prev = 0 when returning into idle-loop */
         ac_port_level_mask(0);
-        ac_port_mpu_reprogram(AC_REGIONS_NUM, context->granted);
+        _ac_mpu_load(context->granted);
     } else {
         ac_port_level_mask(prev->base.prio);
-        ac_port_mpu_reprogram(AC_REGIONS_NUM, prev->granted);
+        _ac_mpu_load(prev->granted);
     }
 
+    _ac_fpu_load(prev);
     return prev_frame;
 }
 
 static inline void ac_actor_restart(struct ac_actor_t* actor) {
+    mg_critical_section_enter();
+    _ac_select_cancel(actor);
+    actor->period = 0;
+    actor->release = 0;
+    mg_critical_section_leave();
+    actor->notified = false;
     actor->restart_req = true;
     _mg_actor_activate(&actor->base);
 }
@@ -323,36 +1410,196 @@ static inline struct ac_port_frame_t* ac_actor_exception(void) {
     struct ac_actor_t* const me = context->running_actor;
     assert(me != 0);
     _ac_message_release(me, true);
+    _ac_slots_release(me, true);
     ac_actor_error(me);
     return _ac_frame_restore_prev();
 }
 
 static inline bool _ac_sys_timeout(struct ac_actor_t* actor, uintptr_t req) {
+#if AC_TICKLESS || AC_TIMER_WHEEL
+    if (req) {
+        mg_critical_section_enter();
+        _ac_timed_arm(actor, (uint32_t) req);
+        mg_critical_section_leave();
+    }
+#else
     actor->base.timeout = (uint32_t) req;
 
     if (req) {
         _mg_actor_timeout(&actor->base);
     }
+#endif
+    return (req != 0);
+}
+
+/*
+ * Microsecond delay is armed directly in the microsecond mode. Otherwise it
+ * is the delay of whole ticks, nonzero one takes at least a tick.
+ */
+static inline bool _ac_sys_delay_us(struct ac_actor_t* actor, uintptr_t req) {
+#if AC_TIMER_US
+    if (req) {
+        mg_critical_section_enter();
+        _ac_timed_arm_at(actor, _ac_timed_now(AC_GET_CONTEXT()) + _ac_timed_us((uint32_t) req));
+        mg_critical_section_leave();
+    }
 
     return (req != 0);
+#else
+    return _ac_sys_timeout(actor, _ac_timed_us((uint32_t) req));
+#endif
+}
+
+/*
+ * Delay which may expire up to the slack later. Like the periodic one it is
+ * armed in the kernel timeouts in all modes.
+ */
+static inline bool _ac_sys_delay_slack(struct ac_actor_t* actor, uintptr_t req) {
+    struct ac_cpu_context_t* const context = AC_GET_CONTEXT();
+    const uint32_t ticks = req & AC_CALL_CHAN_MASK;
+    const uint32_t slack = (req >> AC_CALL_CHAN_BITS) & AC_CALL_CHAN_MASK;
+
+    if (ticks == 0) {
+        return false;
+    }
+
+    mg_critical_section_enter();
+    const uint32_t deadline = _ac_timed_now(context) + _ac_timed_ticks(ticks);
+    _ac_timed_arm_at(actor, _ac_timed_coalesce(deadline, _ac_timed_ticks(slack)));
+    mg_critical_section_leave();
+    return true;
+}
+
+/*
+ * Periodic delay. The release tick advances by the period from the previous
+ * release rather than from the call, so neither the run time of the actor 
+ * nor its preemption accumulates. The first call or the change of the period
+ * starts the phase at the current tick. Releases missed by an overrun are 
+ * skipped keeping the phase. Unlike the delay the kernel timeout is used in 
+ * all modes to arm the absolute tick in the same critical section. The 
+ * period is clamped like delays, so the release stays comparable with the
+ * current time. Restart of the actor starts a new phase.
+ */
+static inline bool _ac_sys_periodic(struct ac_actor_t* actor, uintptr_t req) {
+    struct ac_cpu_context_t* const context = AC_GET_CONTEXT();
+    const uint32_t period = _ac_timed_ticks((uint32_t) req);
+
+    if (period == 0) {
+        actor->period = 0;
+        return false;
+    }
+
+    mg_critical_section_enter();
+    const uint32_t now = _ac_timed_now(context);
+
+    if (actor->period != period) {
+        actor->period = period;
+        actor->release = now;
+    }
+
+    actor->release += period;
+
+    if (!_ac_time_before(now, actor->release)) {
+        actor->release += ((now - actor->release) / period + 1) * period;
+    }
+
+    _ac_timed_arm_at(actor, actor->release);
+    mg_critical_section_leave();
+    return true;
+}
+
+/*
+ * Reader takes the pending message if any, otherwise it waits for the next
+ * push. Actors which aren't readers of the channel are blocked like 
+ * subscribers of invalid channels.
+ */
+static inline struct ac_message_t* _ac_broadcast_subscribe(
+    struct ac_actor_t* actor, 
+    struct ac_channel_t* chan
+) {
+    struct ac_reader_t* r = chan->readers;
+    struct ac_message_t* msg = 0;
+
+    while (r && r->actor != actor) {
+        r = r->next;
+    }
+
+    if (r) {
+        mg_critical_section_enter();
+        msg = r->pending;
+        r->pending = 0;
+        actor->reader = msg ? 0 : r;
+        mg_critical_section_leave();
+    }
+
+    if (msg) {
+        actor->msg_shared = chan;
+    }
+
+    return msg;
+}
+
+static inline bool _ac_sys_select(
+    struct ac_actor_t* actor, 
+    uintptr_t req, 
+    uint32_t ticks
+);
+
+/*
+ * Waiting for events keeps the owned message, the actor is started with the
+ * taken bits instead. Polling returns zero when there are no events.
+ */
+static inline bool _ac_event_take(
+    struct ac_actor_t* actor, 
+    struct ac_channel_t* chan,
+    unsigned int id,
+    bool wait
+) {
+    mg_critical_section_enter();
+    const uint32_t events = chan->events;
+    const bool is_async = wait && (events == 0);
+    chan->events = 0;
+
+    if (is_async) {
+        _ac_waiter_add(chan, actor);
+        actor->recv_chan = id;
+        actor->select = AC_SELECT_EVENTS | (id << AC_CALL_CHAN_BITS) | 1;
+    }
+
+    mg_critical_section_leave();
+    actor->events = events;
+    actor->notified = !is_async;
+    return is_async;
 }
 
 static inline bool _ac_sys_subscribe(struct ac_actor_t* actor, uintptr_t req) {
     struct ac_channel_t* const chan = ac_channel_validate(actor, req, false);
     bool is_async = true;
 
-    if (chan) {
+    if (chan && chan->is_event) {
+        is_async = _ac_event_take(actor, chan, req & AC_CALL_CHAN_MASK, true);
+    } else if (chan && (chan->prioq || chan->limit)) {
+        const uint32_t set = ((req & AC_CALL_CHAN_MASK) << AC_CALL_CHAN_BITS) | 1;
+        is_async = _ac_sys_select(actor, set, 0);
+    } else if (chan) {
         _ac_message_release(actor, false);
-        struct ac_message_t* msg = mg_message_alloc(&chan->base);
-        
-        if (msg == 0) {
-            msg = (void*) mg_queue_pop(&chan->base.queue, &actor->base);
+        actor->recv_chan = req;
+        struct ac_message_t* msg = 0;
+
+        if (chan->refs) {
+            msg = _ac_broadcast_subscribe(actor, chan);
+        } else {
+            msg = mg_message_alloc(&chan->base);
+
+            if (msg == 0) {
+                msg = (void*) mg_queue_pop(&chan->base.queue, &actor->base);
+            }
         }
 
         if (msg) {
             actor->base.mailbox = &msg->header;
             _ac_message_bind(actor);
-            ac_port_update_region(AC_REGION_MSG, &actor->granted[AC_REGION_MSG]);
+            _ac_mpu_load(actor->granted);
             is_async = false;
         }
     }
@@ -365,24 +1612,194 @@ static inline void _ac_sys_push(struct ac_actor_t* actor, uintptr_t req) {
 
     if (chan) {
         _ac_channel_push(actor, chan);
-        ac_port_update_region(AC_REGION_MSG, &actor->granted[AC_REGION_MSG]);
+        _ac_mpu_load(actor->granted);
     }
 }
 
 static inline void _ac_sys_trypop(struct ac_actor_t* actor, uintptr_t req) {
     struct ac_channel_t* const chan = ac_channel_validate(actor, req, false);
 
-    if (chan) {
+    if (chan && chan->is_event) {
+        (void) _ac_event_take(actor, chan, req, false);
+    } else if (chan) {
+        _ac_message_release(actor, false);
+        actor->recv_chan = req;
+        actor->base.mailbox = (void*) _ac_channel_poll(chan);
+        _ac_message_bind(actor);
+        _ac_mpu_load(actor->granted);
+    }
+}
+
+static inline bool _ac_sys_push_subscribe(
+    struct ac_actor_t* actor, 
+    uintptr_t req
+) {
+    const unsigned int dst_id = (req >> AC_CALL_CHAN_BITS) & AC_CALL_CHAN_MASK;
+    const unsigned int src_id = req & AC_CALL_CHAN_MASK;
+    struct ac_channel_t* const dst = ac_channel_validate(actor, dst_id, true);
+
+    /* Rejected request is freed and the call is completed with no reply. */
+    if (dst && !_ac_channel_push(actor, dst)) {
         _ac_message_release(actor, false);
-        actor->base.mailbox = mg_message_alloc(&chan->base);
+        _ac_mpu_load(actor->granted);
+        return false;
+    }
+
+    /*
+     * Message region is not updated after the push: synchronous subscribe
+     * updates it with the new message and asynchronous one reloads the 
+     * changed regions on return to the preempted actor.
+     */
+    return _ac_sys_subscribe(actor, src_id);
+}
+
+/*
+ * The actor is registered as selector of each channel of the set before 
+ * polling, the set of a single channel queues it as a waiter, so any number
+ * of actors may subscribe to the same channel. While it polls, messages pushed into the set are queued, so none
+ * of them is taken out of order, and the set is polled again if any have 
+ * arrived. The wait starts when the set stays empty, nonzero ticks arm its 
+ * timeout then. Pending events complete the call with no message, the bits
+ * are left in the channel to be taken by polling. Broadcast and invalid
+ * channels are rejected, so are the channels of a larger set which another
+ * actor already waits for. The set with none of the channels left completes
+ * the call with no message at once.
+ */
+static inline bool _ac_sys_select(
+    struct ac_actor_t* actor, 
+    uintptr_t req, 
+    uint32_t ticks
+) {
+    const unsigned int base = (req >> AC_CALL_CHAN_BITS) & AC_CALL_CHAN_MASK;
+    uint32_t set = req & AC_CALL_CHAN_MASK;
+    const bool single = (set & (set - 1)) == 0;
+    unsigned int src_id = 0;
+    struct ac_message_t* msg = 0;
+    bool notified = false;
+    _ac_message_release(actor, false);
+    mg_critical_section_enter();
+
+    for (unsigned int i = 0; i < AC_CALL_CHAN_BITS; ++i) {
+        struct ac_channel_t* const chan = (set & (UINT32_C(1) << i)) ?
+            ac_channel_validate(actor, base + i, false) : 0;
+
+        if (chan && (chan->refs == 0) && single) {
+            _ac_waiter_add(chan, actor);
+            actor->recv_chan = base + i;
+        } else if (chan && (chan->refs == 0) && !chan->selector && !chan->waiters) {
+            chan->selector = actor;
+            chan->selector_id = base + i;
+        } else {
+            set &= ~(UINT32_C(1) << i);
+        }
+    }
+
+    if (set == 0) {
+        actor->select = 0;
+        mg_critical_section_leave();
+        return false;
+    }
+
+    actor->select = AC_SELECT_POLL | (base << AC_CALL_CHAN_BITS) | set;
+
+    for (;;) {
+        mg_critical_section_leave();
+        uint32_t mask = set;
+
+        for (unsigned int i = 0; mask && (msg == 0) && !notified; ++i, mask >>= 1) {
+            if (mask & 1) {
+                struct ac_channel_t* const src = ac_channel_validate(actor, base + i, false);
+                src_id = base + i;
+
+                if (src && src->is_event) {
+                    notified = (src->events != 0);
+                } else if (src) {
+                    msg = _ac_channel_poll(src);
+                }
+            }
+        }
+
+        mg_critical_section_enter();
+
+        if (msg || notified || !(actor->select & AC_SELECT_REPOLL)) {
+            break;
+        }
+
+        actor->select &= ~AC_SELECT_REPOLL;
+    }
+
+    if (msg || notified) {
+        _ac_select_cancel(actor);
+        actor->recv_chan = src_id;
+    } else {
+        actor->select &= ~AC_SELECT_POLL;
+
+        if (ticks) {
+            _ac_timed_arm(actor, ticks);
+        }
+    }
+
+    mg_critical_section_leave();
+
+    if (msg) {
+        actor->base.mailbox = &msg->header;
         _ac_message_bind(actor);
-        ac_port_update_region(AC_REGION_MSG, &actor->granted[AC_REGION_MSG]);
+        _ac_mpu_load(actor->granted);
+    }
+
+    return (msg == 0) && !notified;
+}
+
+/*
+ * Subscribe which is completed either by a message or by the timeout, the
+ * latter is reported as no message. Zero timeout means polling.
+ */
+static inline bool _ac_sys_subscribe_timed(
+    struct ac_actor_t* actor, 
+    uintptr_t req
+) {
+    const uint32_t ticks = (req >> AC_CALL_CHAN_BITS) & AC_CALL_CHAN_MASK;
+    const unsigned int id = req & AC_CALL_CHAN_MASK;
+
+    if (ticks == 0) {
+        _ac_sys_trypop(actor, id);
+        return false;
     }
+
+    return _ac_sys_select(actor, (id << AC_CALL_CHAN_BITS) | 1, ticks);
 }
 
 static inline void _ac_sys_free(struct ac_actor_t* actor) {
     _ac_message_release(actor, false);
-    ac_port_update_region(AC_REGION_MSG, &actor->granted[AC_REGION_MSG]);
+    _ac_mpu_load(actor->granted);
+}
+
+static inline void _ac_sys_notify(struct ac_actor_t* actor, uintptr_t req) {
+    const uint32_t bits = (req >> AC_CALL_CHAN_BITS) & AC_CALL_CHAN_MASK;
+    const unsigned int id = req & AC_CALL_CHAN_MASK;
+    struct ac_channel_t* const chan = ac_channel_validate(actor, id, true);
+
+    if (chan && chan->is_event) {
+        ac_channel_notify(chan, bits);
+    }
+}
+
+static inline void _ac_sys_slot(struct ac_actor_t* actor, uintptr_t req) {
+#if AC_MSG_SLOTS
+    const unsigned int i = req & AC_CALL_SLOT_MASK;
+
+    if (i >= AC_MSG_SLOTS) {
+        return; /* Invalid slots are ignored like invalid channels. */
+    }
+
+    if (req & AC_CALL_SLOT_FREE) {
+        _ac_slot_release(actor, i, false);
+    } else if (actor->msg_shared == 0) { /* shared ones can't be parked */
+        _ac_slot_swap(actor, i);
+    }
+
+    _ac_mpu_load(actor->granted);
+#endif
 }
 
 static inline struct ac_port_frame_t* _ac_svc_handler(
@@ -413,12 +1830,36 @@ static inline struct ac_port_frame_t* _ac_svc_handler(
         case AC_CALL_FREE:
             _ac_sys_free(actor);
             break;
+        case AC_CALL_PUSH_SUBSCRIBE:
+            is_async = _ac_sys_push_subscribe(actor, arg);
+            break;
+        case AC_CALL_SLOT:
+            _ac_sys_slot(actor, arg);
+            break;
+        case AC_CALL_SELECT:
+            is_async = _ac_sys_select(actor, arg, 0);
+            break;
+        case AC_CALL_SUBSCRIBE_TIMED:
+            is_async = _ac_sys_subscribe_timed(actor, arg);
+            break;
+        case AC_CALL_NOTIFY:
+            _ac_sys_notify(actor, arg);
+            break;
+        case AC_CALL_PERIODIC:
+            is_async = _ac_sys_periodic(actor, arg);
+            break;
+        case AC_CALL_DELAY_US:
+            is_async = _ac_sys_delay_us(actor, arg);
+            break;
+        case AC_CALL_DELAY_SLACK:
+            is_async = _ac_sys_delay_slack(actor, arg);
+            break;
         }
 
         if (is_async) {
             frame = _ac_frame_restore_prev();
         } else {
-            ac_port_frame_set_arg(frame, actor->base.mailbox);
+            ac_port_frame_set_arg(frame, _ac_actor_arg(actor));
         }
     } else {
         frame = ac_actor_exception();
@@ -427,5 +1868,27 @@ static inline struct ac_port_frame_t* _ac_svc_handler(
     return frame;
 }
 
+/*
+ * Direct handoff. It is called by the port after synchronous syscall. If the
+ * call has activated an actor outranking the caller then the port claims its
+ * vector and the actor is started right away within the same syscall. The 
+ * caller's frame becomes preempted one as if an interrupt occured, so the 
+ * exception return and entry pair is avoided.
+ * The same function is called with the previous frame after asynchronous
+ * syscall. Since the vector is re-requested while more actors are queued at 
+ * the level, the next one is tail-chained in place of the completed actor.
+ */
+static inline struct ac_port_frame_t* _ac_svc_handoff(
+    struct ac_port_frame_t* frame
+) {
+    unsigned int vect = 0;
+
+    if (ac_port_intr_claim(&vect)) {
+        frame = _ac_intr_handler(vect, frame);
+    }
+
+    return frame;
+}
+
 #endif /* header guard */
 
@@ -11,6 +11,15 @@
  *    respectively. These priorities must not be used for actors.
  *  - Exception return procedure acts as a barrier for MPU reprogramming so
  *    no need for explicit DSB/ISB.
+ *  - When built with AC_PORT_FPU (traps.s needs the same assembler symbol)
+ *    FP state is preserved lazily by the hardware. Only actors with the FPU
+ *    flag are granted access to the FPU, others get UsageFault on the first 
+ *    FP instruction and never have extended frames.
+ *  - Regions are kept as the images of RBAR/RASR pairs with VALID bit and 
+ *    the region number set, so 4 consecutive regions are the image of the 
+ *    RBAR/RASR alias block copied by two load/store multiple pairs. Region 
+ *    number is the index in the array, it is set once and kept by the init and
+ *    the swap.
  */
 
 #ifndef AC_PORT_H
@@ -29,7 +38,8 @@ enum {
     AC_PORT_REGION_FLASH,
     AC_PORT_REGION_SRAM,
     AC_PORT_REGION_STACK,
-    AC_PORT_REGIONS_NUM
+    AC_PORT_REGIONS_NUM,
+    AC_PORT_REGIONS_MAX = 8,
 };
 
 struct ac_port_frame_t {
@@ -68,6 +78,40 @@ static inline void ac_port_level_mask(unsigned int level) {
     asm volatile ("MSR basepri, %0" : : "r" (value) );
 }
 
+//
+// Used for direct handoff and tail-chaining inside the syscall. Takes the highest priority
+// pending interrupt if it belongs to an actor and outranks the current level.
+// Zero BASEPRI means that idle-loop is running and any actor outranks it.
+// Actor vectors are recognized by ac_port_intr_entry in the vector table.
+// Pending bit is cleared so the interrupt is not taken on exception return.
+//
+static inline bool ac_port_intr_claim(unsigned int* vect) {
+    extern void ac_port_intr_entry(void);
+    volatile uint32_t* const icsr = (void*) 0xe000ed04u;
+    volatile uint32_t* const vtor = (void*) 0xe000ed08u;
+    volatile uint32_t* const icpr = (void*) 0xe000e280u;
+    volatile uint8_t* const ipr = (void*) 0xe000e400u;
+    const uint32_t exc_id = (*icsr >> 12) & 0x1ff;
+    const uintptr_t entry = (uintptr_t) &ac_port_intr_entry;
+    uint32_t basepri = 0;
+
+    if (exc_id < 16) {
+        return false;
+    }
+
+    const uint32_t irq = exc_id - 16;
+    const uint32_t* const vectors = (const uint32_t*) (uintptr_t) *vtor;
+    asm volatile ("mrs %0, basepri" : "=r" (basepri));
+
+    if (((vectors[exc_id] ^ entry) & ~1u) || (basepri && ipr[irq] >= basepri)) {
+        return false;
+    }
+
+    icpr[irq / 32] = UINT32_C(1) << (irq % 32);
+    *vect = irq;
+    return true;
+}
+
 enum {
     //   name    |   XN    |  AP[2:0]  | S C B bits | ENABLED
     AC_ATTR_RO =             (6 << 24) | (2 << 16)  | 1,
@@ -80,6 +124,22 @@ struct ac_port_region_t {
     uint32_t attr;
 };
 
+enum {
+    AC_PORT_RBAR_VALID = 1 << 4,
+    AC_PORT_RBAR_REGION = 0xf,
+    AC_PORT_MPU_ALIASES = 4,
+};
+
+static inline void ac_port_region_ids_init(
+    size_t sz, 
+    struct ac_port_region_t* regions
+) {
+    for (size_t i = 0; i < sz; ++i) {
+        regions[i].addr = AC_PORT_RBAR_VALID | i;
+        regions[i].attr = 0;
+    }
+}
+
 static inline void ac_port_region_init(
     struct ac_port_region_t* region, 
     uintptr_t addr, 
@@ -88,48 +148,150 @@ static inline void ac_port_region_init(
 ) {
     const size_t msb = 31 - mg_port_clz(size);
     const uint32_t size_mask = (msb - 1) << 1;
-    region->addr = addr;
+    const uint32_t id = region->addr & AC_PORT_RBAR_REGION;
+    region->addr = addr | AC_PORT_RBAR_VALID | id;
     region->attr = size ? (size_mask | attr) : 0;
 }
 
+//
+// Swaps the images of two regions, the region numbers are kept by their 
+// indices, so the swapped regions are the only ones reloaded.
+//
+static inline void ac_port_region_swap(
+    struct ac_port_region_t* a, 
+    struct ac_port_region_t* b
+) {
+    const uint32_t ids = (a->addr ^ b->addr) & AC_PORT_RBAR_REGION;
+    const struct ac_port_region_t temp = *a;
+    *a = *b;
+    *b = temp;
+    a->addr ^= ids;
+    b->addr ^= ids;
+}
+
 static inline void ac_port_update_region_nosync(
-    unsigned int region_id, 
     const struct ac_port_region_t* region
 ) {
-    volatile struct {
-        uint32_t type;
-        uint32_t ctrl;
-        uint32_t rnr; 
-        uint32_t rbar;
-        uint32_t rasr;
-    } * const mpu = (void*) 0xE000ED90UL;
-
-    mpu->rbar = region->addr | (1 << 4) | region_id;
-    mpu->rasr = region->attr;
+    volatile uint32_t* const rbar = (void*) 0xe000ed9cu;
+    rbar[0] = region->addr;
+    rbar[1] = region->attr;
 }
 
-static inline void ac_port_update_region(
-    unsigned int region_id, 
-    const struct ac_port_region_t* region
+//
+// Copies the image of 4 consecutive regions into the RBAR/RASR pair and its
+// 3 aliases. Only the scratch registers are used, so the frame pointer and 
+// the platform register are left to the compiler.
+//
+static inline void ac_port_update_regions4_nosync(
+    const struct ac_port_region_t* regions
 ) {
+    uintptr_t rbar = 0xe000ed9cu;
+    uintptr_t image = (uintptr_t) regions;
+
+    asm volatile (
+        "ldmia %1!, {r0-r3}\n\t"
+        "stmia %0!, {r0-r3}\n\t"
+        "ldmia %1, {r0-r3}\n\t"
+        "stmia %0, {r0-r3}"
+        : "+r" (rbar), "+r" (image)
+        : 
+        : "r0", "r1", "r2", "r3", "memory"
+    );
+}
+
+static inline void ac_port_mpu_reprogram(
+    size_t sz, 
+    const struct ac_port_region_t* regions
+) {
+    size_t i = 0;
     mg_critical_section_enter();
-    ac_port_update_region_nosync(region_id, region);
+
+    for (; i + AC_PORT_MPU_ALIASES <= sz; i += AC_PORT_MPU_ALIASES) {
+        ac_port_update_regions4_nosync(&regions[i]);
+    }
+
+    for (; i < sz; ++i) {
+        ac_port_update_region_nosync(&regions[i]);
+    }
+
     mg_critical_section_leave();
 }
 
-static inline void ac_port_mpu_reprogram(
+static inline bool ac_port_region_differs(
+    const struct ac_port_region_t* a,
+    const struct ac_port_region_t* b
+) {
+    return ((a->addr ^ b->addr) | (a->attr ^ b->attr)) != 0;
+}
+
+//
+// Writes only the regions which differ from the loaded ones. Loaded array
+// mirrors the MPU state and is updated in the same critical section. Groups
+// of 4 regions are written at once when any of them differs.
+//
+static inline void ac_port_mpu_update(
     size_t sz, 
+    struct ac_port_region_t* loaded,
     const struct ac_port_region_t* regions
 ) {
+    size_t i = 0;
     mg_critical_section_enter();
 
-    for (size_t i = 0; i < sz; ++i) {
-        ac_port_update_region_nosync(i, &regions[i]);
+    for (; i + AC_PORT_MPU_ALIASES <= sz; i += AC_PORT_MPU_ALIASES) {
+        bool differs = false;
+
+        for (size_t j = i; j < i + AC_PORT_MPU_ALIASES; ++j) {
+            differs |= ac_port_region_differs(&loaded[j], &regions[j]);
+        }
+
+        if (differs) {
+            ac_port_update_regions4_nosync(&regions[i]);
+
+            for (size_t j = i; j < i + AC_PORT_MPU_ALIASES; ++j) {
+                loaded[j] = regions[j];
+            }
+        }
+    }
+
+    for (; i < sz; ++i) {
+        if (ac_port_region_differs(&loaded[i], &regions[i])) {
+            ac_port_update_region_nosync(&regions[i]);
+            loaded[i] = regions[i];
+        }
     }
 
     mg_critical_section_leave();
 }
 
+#if AC_PORT_FPU
+enum {
+    AC_PORT_CPACR_PRIV = 5 << 20,   /* CP10/CP11 privileged access only */
+    AC_PORT_CPACR_FULL = 15 << 20,
+};
+
+//
+// Kernel keeps privileged access to the FPU since it saves FP registers of the
+// preempted actor while the next one is already granted.
+//
+static inline void ac_port_fpu_grant(bool enabled) {
+    volatile uint32_t* const cpacr = (void*) 0xe000ed88u;
+    *cpacr = enabled ? AC_PORT_CPACR_FULL : AC_PORT_CPACR_PRIV;
+}
+
+//
+// S0-S15 of the interrupted context are saved lazily by the first FP 
+// instruction using its MPU regions. The asm part triggers the save if it is
+// pending, the kernel calls it before the regions of another actor are loaded.
+// The save of the completed actor is dropped by resetting LSPACT.
+//
+extern void ac_port_fpu_lazy_save(void);
+
+static inline void ac_port_fpu_lazy_drop(void) {
+    volatile uint32_t* const fpccr = (void*) 0xe000ef34u;
+    *fpccr &= ~1u;
+}
+#endif
+
 //
 // The kernel sets CONTROL just once so code of 'idle' is also subjected
 // to MPU restrictions. This code sets up minimal MPU regions required for 
@@ -159,11 +321,18 @@ static inline void ac_port_init(
     stack &= ~(full_context_sz - 1);
     stack -= full_context_sz;
 
+    ac_port_region_ids_init(sz, regions);
     ac_port_region_init(&regions[AC_PORT_REGION_FLASH], ro_base, 64, AC_ATTR_RO);
     ac_port_region_init(&regions[AC_PORT_REGION_STACK], stack, full_context_sz, AC_ATTR_RW);
     ac_port_mpu_reprogram(sz, regions);
     ac_port_level_mask(2); /* blocks any user actor */
 
+#if AC_PORT_FPU
+    volatile uint32_t* const fpccr = (void*) 0xe000ef34u;
+    *fpccr |= UINT32_C(3) << 30; /* ASPEN | LSPEN */
+    ac_port_fpu_grant(false);
+#endif
+
     *mpu_ctrl = MPU_PRIVDEFENA | MPU_ENABLE;
     asm volatile ("dsb");
     asm volatile ("isb");
@@ -4,18 +4,27 @@
  */
 
 .syntax unified
+.ifdef AC_PORT_FPU
+.cpu cortex-m4
+.fpu fpv4-sp-d16
+.else
 .cpu cortex-m3
 .fpu softvfp
+.endif
 .thumb
 
 .set SHCSR,0xe000ed24
 .set MPU_RNR,0xe000ed98
+.set FPCCR,0xe000ef34
 
 .global ac_kernel_start
 .global ac_port_intr_entry
 .global ac_port_svc_entry
 .global ac_port_trap_entry
 .global ac_port_idle_text
+.ifdef AC_PORT_FPU
+.global ac_port_fpu_lazy_save
+.endif
 
 .section .text
 
@@ -31,8 +40,49 @@
  * LSB of the frame pointer is also used as a flag indicating return mode:
  * 0 - usermode frame, 1 - kernel-mode frame. This bit also selects
  * the appropriate stack pointer on return.
+ *
+ * When built with AC_PORT_FPU the high part also contains EXC_RETURN of the
+ * preempted context, R3 is saved just to keep MSP aligned. If the context 
+ * has active FP state (extended frame) S16-S31 are saved above the high part.
+ * Hardware frame of such context contains space for S0-S15 which are saved
+ * lazily by the first FP instruction. The lazy save uses the privilege and
+ * the MPU regions of the context, so the kernel triggers it only when another
+ * actor is about to be started and drops it when the context completes. 
+ * Entries which switch nothing (interrupts without activation, synchronous
+ * syscalls without handoff) don't save S0-S15. So contexts without FP state
+ * are never slowed down by FP saving.
+ */
+
+.ifdef AC_PORT_FPU
+
+.macro  high_regs_save      // Save the high part of the context, LR = EXC_RETURN.
+    tst     lr, #16         // Is the frame extended?
+    it      eq
+    vstmdbeq sp!, { s16-s31 } // Yes, save FP registers also.
+    stmdb   sp!, { r3-r11, lr }
+.endm
+
+.macro  high_regs_load      // Load the high part of the next context.
+    ldmia   sp!, { r3-r11, lr }
+    tst     lr, #16         // Is the frame extended?
+    it      eq
+    vldmiaeq sp!, { s16-s31 } // Yes, load FP registers also.
+.endm
+
+/*
+ * Called by the kernel before the regions of another actor are loaded.
  */
 
+.type ac_port_fpu_lazy_save, %function
+ac_port_fpu_lazy_save:
+    ldr     r0, =FPCCR
+    ldr     r0, [r0]
+    lsls    r0, #31         // Is the lazy save pending (LSPACT)?
+    it      ne
+    vmrsne  r0, fpscr       // Yes, S0-S15 are saved while regions are the same.
+    bx      lr
+.endif
+
 .type ac_port_intr_entry, %function
 ac_port_intr_entry:
     mrs     r0, psp         // MRS can't be in IT block, read for further use.
@@ -42,6 +92,17 @@ ac_port_intr_entry:
     movne   r1, r0          // Yes, frame in previously read PSP.
     mrs     r0, ipsr        // Provide 1st argument, vector number.
     subs    r0, #16         // Get interrupt vector by exception id.
+.ifdef AC_PORT_FPU
+    push    { r4, lr }
+    movs    r4, r1          // Preserve the frame ptr in callee-saved reg.
+    bl      ac_intr_handler // Get the next frame in R0.
+    movs    r1, r4
+    pop     { r4, lr }      // LR = EXC_RETURN of the same frame.
+    cmp     r0, r1          // Is new frame allocated?
+    beq     exc_return
+    high_regs_save          // Yes, save hi registers of the preempted actor on MSP.
+    mvn     lr, #0          // New frame is never extended.
+.else
     push    { r4 }
     movs    r4, r1          // Preserve the frame ptr in callee-saved reg.
     bl      ac_intr_handler // Get the next frame in R0.
@@ -50,6 +111,7 @@ ac_port_intr_entry:
     cmp     r0, r1          // Is new frame allocated?
     it      ne
     stmdbne sp!, { r4-r11 } // Yes, save hi registers of the preempted actor on MSP.
+.endif
     b       exc_return
 
 /*
@@ -72,13 +134,23 @@ ac_port_trap_entry:
     isb
     mrs     r0, ipsr
     bl      ac_trap_handler
+.ifdef AC_PORT_FPU
+    high_regs_load          // Load the high registers of the next actor.
+.else
     ldmia   sp!, { r4-r11 } // Load the high registers of the next actor.
+.endif
     b       exc_return
 
 /*
  * Syscall handler. Syscalls are allowed from usermode only so no need to 
  * check the LR. If the handler returns the same frame as its input it
  * means that the call is synchronous.
+ * Synchronous call may activate an actor which outranks the caller. In that
+ * case the handoff handler returns a new frame and the caller is treated as
+ * preempted one just like in the interrupt handler.
+ * When asynchronous call completes the actor the handoff handler starts the
+ * next pending actor in place of the previous one, so its high registers are
+ * left on the MSP as if it was preempted by the interrupt.
  * Syscall exception must have priority less than other faults so they
  * will take priority in case of errors during the stacking.
  */
@@ -89,23 +161,62 @@ ac_port_svc_entry:
     beq     enable_umode    // It is used to enable unprivileged threads.
     mrs     r1, psp         // Read the frame pointer.
     ldr     r0, [r1]        // Read syscall argument in r0 from the frame.
+.ifdef AC_PORT_FPU
+    push    { r4, lr }
+.else
     push    { r4 }
+.endif
     movs    r4, r1          // Preserve the frame ptr in callee-saved reg.
     bl      ac_svc_handler  // Get the next frame.
+    cmp     r0, r4          // Is this call is synchronous (same frame)?
+    bne     svc_async
+    bl      ac_svc_handoff  // Yes, get the frame of the activated actor.
     movs    r1, r4
+.ifdef AC_PORT_FPU
+    pop     { r4, lr }      // LR = EXC_RETURN of the caller.
+    cmp     r0, r1          // Is new frame allocated?
+    beq     exc_return
+    high_regs_save          // Yes, save hi registers of the caller on MSP.
+    mvn     lr, #0          // New frame is never extended.
+.else
     pop     { r4 }
-    cmp     r0, r1          // Is this call is synchronous (same frame)?
+    cmp     r0, r1          // Is new frame allocated?
     it      ne
-    ldmiane sp!, { r4-r11 } // No, load hi registers of the previous actor.
+    stmdbne sp!, { r4-r11 } // Yes, save hi registers of the caller on MSP.
+.endif
+    b       exc_return
+svc_async:
+    movs    r4, r0          // Preserve the frame of the previous actor.
+    bl      ac_svc_handoff  // Tail-chain the next pending actor if any.
+    movs    r1, r4
+.ifdef AC_PORT_FPU
+    pop     { r4, lr }      // LR = EXC_RETURN of the completed actor.
+    mvn     lr, #0          // New frame is never extended.
+    cmp     r0, r1          // Is new frame allocated?
+    bne     exc_return
+    high_regs_load          // No, load hi registers of the previous actor.
+.else
+    pop     { r4 }
+    cmp     r0, r1          // Is new frame allocated?
+    it      eq
+    ldmiaeq sp!, { r4-r11 } // No, load hi registers of the previous actor.
+.endif
     b       exc_return    
 
 /*
  * We came here with R0 pointing to the stack frame. The high registers
- * for the next actor are already on to of the MSP.
+ * for the next actor are already on to of the MSP. With AC_PORT_FPU the 
+ * frame type bit is taken from LR which is EXC_RETURN of the next context.
  */
 
 exc_return:
+.ifdef AC_PORT_FPU
+    and     r2, lr, #16     // Keep the frame type bit.
+    mvn     lr, #30         // 0xffffffe1 = return to handler, extended frame.
+    orr     lr, r2          // Basic frame if the bit is set.
+.else
     mvn     lr, #14         // 0xfffffff1 = return to handler. Adjusted later.
+.endif
     mrs     r1, psp         // Pre-read PSP as mrs isn't allows in IT block.
     tst     r0, #1          // Return to handler mode?
     ittee   ne
@@ -159,5 +270,7 @@ ac_kernel_start:
     adds    r1, #32         // Add frame size = top of stack.
     mov     sp, r1
     svc     0
-    b       .
+idle:
+    wfi                     // Sleep until the next interrupt.
+    b       idle
 
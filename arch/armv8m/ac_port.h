@@ -11,6 +11,20 @@
  *    respectively. These priorities must not be used for actors.
  *  - Exception return procedure acts as a barrier for MPU reprogramming so
  *    no need for explicit DSB/ISB.
+ *  - PSPLIM follows the base of the stack region, so stack overflow is caught
+ *    by the push itself (STKOF UsageFault) even when the memory below the
+ *    stack is accessible through another region. The region is still needed
+ *    since the stack limit doesn't grant unprivileged access.
+ *  - When built with AC_PORT_FPU (traps.s needs the same assembler symbol)
+ *    FP state is preserved lazily by the hardware. Only actors with the FPU
+ *    flag are granted access to the FPU, others get UsageFault on the first 
+ *    FP instruction and never have extended frames.
+ *  - AC_PORT_MPU_WAYS > 1 keeps code, data and stack regions of the recently
+ *    activated actors in spare MPU regions, so switching to such actor only
+ *    flips enable bits. Way N uses regions 4N..4N+2, so its limit registers
+ *    are written through the RLAR aliases after a single RNR write. Regions
+ *    4N+3 and the ones above the last way hold the rest of the actor's 
+ *    regions. AC_PORT_MPU_REGIONS is the number of regions implemented.
  */
 
 #ifndef AC_PORT_H
@@ -25,13 +39,30 @@
 #error This file may be used in GNU GCC only because of non-portable functions.
 #endif
 
+#ifndef AC_PORT_MPU_WAYS
+#define AC_PORT_MPU_WAYS 1
+#endif
+
+#ifndef AC_PORT_MPU_REGIONS
+#define AC_PORT_MPU_REGIONS 8
+#endif
+
+#if AC_PORT_MPU_WAYS > 1
+#define AC_PORT_MIRROR_EXTRA ((AC_PORT_MPU_WAYS - 1) * AC_PORT_REGIONS_NUM)
+#endif
+
 enum {
     AC_PORT_REGION_FLASH,
     AC_PORT_REGION_SRAM,
     AC_PORT_REGION_STACK,
-    AC_PORT_REGIONS_NUM
+    AC_PORT_REGIONS_NUM,
+    AC_PORT_REGIONS_MAX = 
+        AC_PORT_MPU_REGIONS - (AC_PORT_MPU_WAYS - 1) * AC_PORT_REGIONS_NUM,
 };
 
+_Static_assert(AC_PORT_MPU_WAYS * 4 - 1 <= AC_PORT_MPU_REGIONS, 
+    "too many MPU ways");
+
 struct ac_port_frame_t {
     uint32_t r0;
     uint32_t r1;
@@ -73,6 +104,40 @@ static inline void ac_port_level_mask(unsigned int level) {
     asm volatile ("msr basepri, %0" : : "r" (value) );
 }
 
+//
+// Used for direct handoff and tail-chaining inside the syscall. Takes the highest priority
+// pending interrupt if it belongs to an actor and outranks the current level.
+// Zero BASEPRI means that idle-loop is running and any actor outranks it.
+// Actor vectors are recognized by ac_port_intr_entry in the vector table.
+// Pending bit is cleared so the interrupt is not taken on exception return.
+//
+static inline bool ac_port_intr_claim(unsigned int* vect) {
+    extern void ac_port_intr_entry(void);
+    volatile uint32_t* const icsr = (void*) 0xe000ed04u;
+    volatile uint32_t* const vtor = (void*) 0xe000ed08u;
+    volatile uint32_t* const icpr = (void*) 0xe000e280u;
+    volatile uint8_t* const ipr = (void*) 0xe000e400u;
+    const uint32_t exc_id = (*icsr >> 12) & 0x1ff;
+    const uintptr_t entry = (uintptr_t) &ac_port_intr_entry;
+    uint32_t basepri = 0;
+
+    if (exc_id < 16) {
+        return false;
+    }
+
+    const uint32_t irq = exc_id - 16;
+    const uint32_t* const vectors = (const uint32_t*) (uintptr_t) *vtor;
+    asm volatile ("mrs %0, basepri" : "=r" (basepri));
+
+    if (((vectors[exc_id] ^ entry) & ~1u) || (basepri && ipr[irq] >= basepri)) {
+        return false;
+    }
+
+    icpr[irq / 32] = UINT32_C(1) << (irq % 32);
+    *vect = irq;
+    return true;
+}
+
 struct ac_port_region_t {
     uint32_t rbar;
     uint32_t rlar;
@@ -96,6 +161,17 @@ enum {
     AC_ATTR_DEV= (0x9 << 9) | (1 << 8) | (1 << 1) | 1,
 };
 
+//
+// Region images don't contain the region number, nothing to precompute.
+//
+static inline void ac_port_region_ids_init(
+    size_t sz, 
+    struct ac_port_region_t* regions
+) {
+    (void) sz;
+    (void) regions;
+}
+
 static inline void ac_port_region_init(
     struct ac_port_region_t* region, 
     uintptr_t addr, 
@@ -111,6 +187,18 @@ static inline void ac_port_region_init(
     }
 }
 
+//
+// Swaps the images of two regions, used by the message slots.
+//
+static inline void ac_port_region_swap(
+    struct ac_port_region_t* a, 
+    struct ac_port_region_t* b
+) {
+    const struct ac_port_region_t temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
 static inline void ac_port_update_region_nosync(
     unsigned int region_id, 
     const struct ac_port_region_t* region
@@ -131,15 +219,163 @@ static inline void ac_port_update_region_nosync(
     asm volatile ("dmb");
 }
 
-static inline void ac_port_update_region(
-    unsigned int region_id, 
-    const struct ac_port_region_t* region
+static inline void ac_port_stack_limit_set(const struct ac_port_region_t* stack) {
+    const uint32_t limit = stack->rbar & ~0x1fu;
+    asm volatile ("msr psplim, %0" : : "r" (limit));
+}
+
+#if AC_PORT_MPU_WAYS > 1
+enum {
+    AC_PORT_RLAR_EN = 1,
+};
+
+//
+// MPU region holding the actor's region which isn't cached by ways.
+//
+static inline unsigned int ac_port_mpu_slot(size_t i) {
+    const size_t n = i - AC_PORT_REGIONS_NUM;
+    return (n < AC_PORT_MPU_WAYS) ? (n * 4 + 3) : (AC_PORT_MPU_WAYS * 3 + n);
+}
+
+//
+// Way 0 is mirrored at the actor's indices, other ways follow the actor's 
+// regions in the loaded array.
+//
+static inline struct ac_port_region_t* ac_port_mpu_way(
+    size_t sz, 
+    struct ac_port_region_t* loaded,
+    size_t way
+) {
+    return (way == 0) ? loaded : &loaded[sz + (way - 1) * AC_PORT_REGIONS_NUM];
+}
+
+//
+// Writes the limit registers of the way through the aliases, so the whole
+// way is enabled or disabled with a single RNR write.
+//
+static inline void ac_port_mpu_way_set_nosync(
+    size_t way, 
+    struct ac_port_region_t* cached,
+    const uint32_t rlar[static AC_PORT_REGIONS_NUM]
 ) {
+    volatile struct {
+        uint32_t rnr;
+        struct {
+            uint32_t rbar;
+            uint32_t rlar;
+        } alias[4];
+    } * const mpu = (void*) 0xe000ed98u;
+
+    mpu->rnr = way * 4;
+    asm volatile ("dmb");
+
+    for (size_t i = 0; i < AC_PORT_REGIONS_NUM; ++i) {
+        if (cached[i].rlar != rlar[i]) {
+            mpu->alias[i].rlar = rlar[i];
+            cached[i].rlar = rlar[i];
+        }
+    }
+
+    asm volatile ("dmb");
+}
+
+static inline void ac_port_mpu_reprogram(
+    size_t sz, 
+    const struct ac_port_region_t* regions
+) {
+    const struct ac_port_region_t off = { 0, 0 };
     mg_critical_section_enter();
-    ac_port_update_region_nosync(region_id, region);
+
+    for (unsigned int i = 0; i < AC_PORT_MPU_REGIONS; ++i) {
+        ac_port_update_region_nosync(i, &off);
+    }
+
+    for (size_t i = 0; i < sz; ++i) {
+        const unsigned int id = (i < AC_PORT_REGIONS_NUM) ? i : ac_port_mpu_slot(i);
+        ac_port_update_region_nosync(id, &regions[i]);
+    }
+
+    ac_port_stack_limit_set(&regions[AC_PORT_REGION_STACK]);
     mg_critical_section_leave();
 }
 
+//
+// Enabled way holds the regions of the running actor. If the next actor's
+// regions are cached by another way it is enabled after the running one is
+// disabled, regions never overlap since ARMv8-M faults on that. Otherwise the
+// way following the running one is reprogrammed, for 2 ways it is the least
+// recently used one. Cached regions are compared ignoring the enable bit,
+// the rest of the regions are written only when differ. Stack limit follows
+// the way.
+//
+static inline void ac_port_mpu_update(
+    size_t sz, 
+    struct ac_port_region_t* loaded,
+    const struct ac_port_region_t* regions
+) {
+    size_t active = 0;
+    size_t next = AC_PORT_MPU_WAYS;
+    uint32_t rlar[AC_PORT_REGIONS_NUM];
+    mg_critical_section_enter();
+
+    for (size_t way = 0; way < AC_PORT_MPU_WAYS; ++way) {
+        const struct ac_port_region_t* const cached = ac_port_mpu_way(sz, loaded, way);
+        uint32_t differs = 0;
+
+        for (size_t i = 0; i < AC_PORT_REGIONS_NUM; ++i) {
+            differs |= (cached[i].rbar ^ regions[i].rbar);
+            differs |= (cached[i].rlar ^ regions[i].rlar) & ~AC_PORT_RLAR_EN;
+        }
+
+        if (cached[AC_PORT_REGION_STACK].rlar & AC_PORT_RLAR_EN) {
+            active = way;
+        }
+
+        if (differs == 0 && next == AC_PORT_MPU_WAYS) {
+            next = way;
+        }
+    }
+
+    if (next != active) {
+        struct ac_port_region_t* const cached = ac_port_mpu_way(sz, loaded, active);
+
+        for (size_t i = 0; i < AC_PORT_REGIONS_NUM; ++i) {
+            rlar[i] = cached[i].rlar & ~AC_PORT_RLAR_EN;
+        }
+
+        ac_port_mpu_way_set_nosync(active, cached, rlar);
+    }
+
+    if (next == AC_PORT_MPU_WAYS) {
+        next = (active + 1) % AC_PORT_MPU_WAYS;
+        struct ac_port_region_t* const cached = ac_port_mpu_way(sz, loaded, next);
+
+        for (size_t i = 0; i < AC_PORT_REGIONS_NUM; ++i) {
+            ac_port_update_region_nosync(next * 4 + i, &regions[i]);
+            cached[i] = regions[i];
+        }
+    } else if (next != active) {
+        for (size_t i = 0; i < AC_PORT_REGIONS_NUM; ++i) {
+            rlar[i] = regions[i].rlar;
+        }
+
+        ac_port_mpu_way_set_nosync(next, ac_port_mpu_way(sz, loaded, next), rlar);
+    }
+
+    if (next != active) {
+        ac_port_stack_limit_set(&regions[AC_PORT_REGION_STACK]);
+    }
+
+    for (size_t i = AC_PORT_REGIONS_NUM; i < sz; ++i) {
+        if ((loaded[i].rbar ^ regions[i].rbar) | (loaded[i].rlar ^ regions[i].rlar)) {
+            ac_port_update_region_nosync(ac_port_mpu_slot(i), &regions[i]);
+            loaded[i] = regions[i];
+        }
+    }
+
+    mg_critical_section_leave();
+}
+#else
 static inline void ac_port_mpu_reprogram(
     size_t sz, 
     const struct ac_port_region_t* regions
@@ -150,9 +386,67 @@ static inline void ac_port_mpu_reprogram(
         ac_port_update_region_nosync(i, &regions[i]);
     }
 
+    ac_port_stack_limit_set(&regions[AC_PORT_REGION_STACK]);
     mg_critical_section_leave();
 }
 
+//
+// Writes only the regions which differ from the loaded ones. Loaded array
+// mirrors the MPU state and is updated in the same critical section. Stack
+// limit is updated along with the stack region. PSP is switched later by the
+// exception return, so the new limit is never violated by the old PSP.
+//
+static inline void ac_port_mpu_update(
+    size_t sz, 
+    struct ac_port_region_t* loaded,
+    const struct ac_port_region_t* regions
+) {
+    mg_critical_section_enter();
+
+    if (loaded[AC_PORT_REGION_STACK].rbar != regions[AC_PORT_REGION_STACK].rbar) {
+        ac_port_stack_limit_set(&regions[AC_PORT_REGION_STACK]);
+    }
+
+    for (size_t i = 0; i < sz; ++i) {
+        if ((loaded[i].rbar ^ regions[i].rbar) | (loaded[i].rlar ^ regions[i].rlar)) {
+            ac_port_update_region_nosync(i, &regions[i]);
+            loaded[i] = regions[i];
+        }
+    }
+
+    mg_critical_section_leave();
+}
+#endif
+
+#if AC_PORT_FPU
+enum {
+    AC_PORT_CPACR_PRIV = 5 << 20,   /* CP10/CP11 privileged access only */
+    AC_PORT_CPACR_FULL = 15 << 20,
+};
+
+//
+// Kernel keeps privileged access to the FPU since it saves FP registers of the
+// preempted actor while the next one is already granted.
+//
+static inline void ac_port_fpu_grant(bool enabled) {
+    volatile uint32_t* const cpacr = (void*) 0xe000ed88u;
+    *cpacr = enabled ? AC_PORT_CPACR_FULL : AC_PORT_CPACR_PRIV;
+}
+
+//
+// S0-S15 of the interrupted context are saved lazily by the first FP 
+// instruction using its MPU regions. The asm part triggers the save if it is
+// pending, the kernel calls it before the regions of another actor are loaded.
+// The save of the completed actor is dropped by resetting LSPACT.
+//
+extern void ac_port_fpu_lazy_save(void);
+
+static inline void ac_port_fpu_lazy_drop(void) {
+    volatile uint32_t* const fpccr = (void*) 0xe000ef34u;
+    *fpccr &= ~1u;
+}
+#endif
+
 //
 // This port supports SMP so this function should be called on each CPU.
 // Since each CPU uses its own stack and CPUs number is unknown idle
@@ -186,6 +480,12 @@ static inline void ac_port_init(
     ac_port_mpu_reprogram(sz, regions);
     ac_port_level_mask(2); /* blocks any user actor */
 
+#if AC_PORT_FPU
+    volatile uint32_t* const fpccr = (void*) 0xe000ef34u;
+    *fpccr |= UINT32_C(3) << 30; /* ASPEN | LSPEN */
+    ac_port_fpu_grant(false);
+#endif
+
     *mpu_ctrl = MPU_PRIVDEFENA | MPU_ENABLE;
     asm volatile ("dsb");
     asm volatile ("isb");
@@ -4,18 +4,27 @@
  */
 
 .syntax unified
+.ifdef AC_PORT_FPU
+.cpu cortex-m33
+.fpu fpv5-sp-d16
+.else
 .cpu cortex-m3
 .fpu softvfp
+.endif
 .thumb
 
 .set SHCSR,0xe000ed24
 .set MPU_RNR,0xe000ed98
+.set FPCCR,0xe000ef34
 
 .global ac_kernel_start
 .global ac_port_intr_entry
 .global ac_port_svc_entry
 .global ac_port_trap_entry
 .global ac_port_idle_text
+.ifdef AC_PORT_FPU
+.global ac_port_fpu_lazy_save
+.endif
 
 .section .text
 
@@ -31,8 +40,68 @@
  * LSB of the frame pointer is also used as a flag indicating return mode:
  * 0 - usermode frame, 1 - kernel-mode frame. This bit also selects
  * the appropriate stack pointer on return.
+ *
+ * When built with AC_PORT_FPU the high part also contains EXC_RETURN of the
+ * context, R3 is saved just to keep MSP aligned. Kernel-mode frame pointer
+ * points to the hardware frame above the high part. S16-S31 of the context
+ * with active FP state (extended frame) are saved above its high part only
+ * when the context is preempted. Hardware frame of such context contains 
+ * space for S0-S15 which are saved lazily by the first FP instruction. The 
+ * lazy save uses the privilege and the MPU regions of the context, so the
+ * kernel triggers it only when another actor is about to be started and drops
+ * it when the context completes. Entries which switch nothing (interrupts 
+ * without activation, synchronous syscalls without handoff) don't save S0-S15.
+ * So contexts without FP state are never slowed down by FP saving.
  */
 
+.ifdef AC_PORT_FPU
+.type ac_port_intr_entry, %function
+ac_port_intr_entry:
+    mrs     r0, psp         // MRS can't be in IT block, read for further use.
+    tst     lr, #4          // Is usermode interrupted?
+    ite     eq              //
+    addeq   r1, sp, #1      // No, get the frame ptr from MSP plus mode flag.
+    movne   r1, r0          // Yes, frame in previously read PSP.
+    stmdb   sp!, { r3-r11, lr } // Save callee-saved registers on MSP always.
+    mrs     r0, ipsr        // Provide 1st argument, vector number.
+    subs    r0, #16         // Get interrupt vector by exception id.
+    movs    r4, r1          // Preserve the frame ptr in callee-saved reg.
+    bl      ac_intr_handler // Get the next frame in R0.
+    cmp     r0, r4          // Is new frame allocated?
+    bne     preempt
+    b       exc_return
+
+/*
+ * The high part of the preempted context is on top of the MSP. If its frame 
+ * is extended FP registers are inserted between the high part and the frame.
+ * Then the high part of the new actor is simulated with basic frame type.
+ */
+
+preempt:
+    ldr     r1, [sp, #36]   // EXC_RETURN of the preempted context.
+    tst     r1, #16         // Is the frame extended?
+    bne     1f
+    ldmia   sp!, { r3-r11, lr } // Yes, move the high part below FP registers.
+    vstmdb  sp!, { s16-s31 }
+    stmdb   sp!, { r3-r11, lr }
+1:
+    mvn     lr, #0          // New frame is never extended.
+    stmdb   sp!, { r3-r11, lr } // Simulate STMDB with high regs.
+    b       exc_return
+
+/*
+ * Called by the kernel before the regions of another actor are loaded.
+ */
+
+.type ac_port_fpu_lazy_save, %function
+ac_port_fpu_lazy_save:
+    ldr     r0, =FPCCR
+    ldr     r0, [r0]
+    lsls    r0, #31         // Is the lazy save pending (LSPACT)?
+    it      ne
+    vmrsne  r0, fpscr       // Yes, S0-S15 are saved while regions are the same.
+    bx      lr
+.else
 .type ac_port_intr_entry, %function
 ac_port_intr_entry:
     stmdb   sp!, { r4-r11 } // Save callee-saved registers on MSP always.
@@ -49,6 +118,7 @@ ac_port_intr_entry:
     it      ne
     subsne  sp, #32         // Yes, simulate STMDB with high regs.
     b       exc_return
+.endif
 
 /*
  * In the current design there is (very optimistic) assumption that exceptions
@@ -76,6 +146,12 @@ ac_port_trap_entry:
  * Syscall handler. Syscalls are allowed from usermode only so no need to 
  * check the LR. If the handler returns the same frame is its input it
  * means that this call is synchronous.
+ * Synchronous call may activate an actor which outranks the caller. In that
+ * case the handoff handler returns a new frame and the caller is treated as
+ * preempted one just like in the interrupt handler.
+ * When asynchronous call completes the actor the handoff handler starts the
+ * next pending actor in place of the previous one, so its high registers are
+ * left on the MSP as if it was preempted by the interrupt.
  * Syscall exception must have priority less than other faults so they
  * will take priority in case of errors during the stacking.
  */
@@ -84,15 +160,43 @@ ac_port_trap_entry:
 ac_port_svc_entry:
     tst     lr, #4          // First call from main is a special case.
     beq     enable_umode    // It is used to enable unprivileged threads.
+.ifdef AC_PORT_FPU
+    stmdb   sp!, { r3-r11, lr } // Save high registers on the MSP stack.
+    mrs     r1, psp         // Read the frame pointer.
+    ldr     r0, [r1]        // Read syscall argument in r0 from the frame.
+    movs    r4, r1          // Preserve the frame ptr in callee-saved reg. 
+    bl      ac_svc_handler  // Get the next frame.
+    cmp     r0, r4          // Is this call is synchronous (same frame)?
+    beq     svc_sync
+    add     sp, #40         // No, skip high registers pushed by STMDB.
+    movs    r4, r0          // Preserve the frame of the previous actor.
+    bl      ac_svc_handoff  // Get the frame of the activated actor if any.
+    cmp     r0, r4          // Is new frame allocated?
+    beq     exc_return
+    mvn     lr, #0          // Yes, new frame is never extended.
+    stmdb   sp!, { r3-r11, lr } // Simulate STMDB with high regs.
+    b       exc_return
+svc_sync:
+    bl      ac_svc_handoff  // Get the frame of the activated actor if any.
+    cmp     r0, r4          // Is new frame allocated?
+    bne     preempt         // Yes, the caller is preempted.
+    b       exc_return
+.else
     stmdb   sp!, { r4-r11 } // Save high registers on the MSP stack.
     mrs     r1, psp         // Read the frame pointer.
     ldr     r0, [r1]        // Read syscall argument in r0 from the frame.
     movs    r4, r1          // Preserve the frame ptr in callee-saved reg. 
     bl      ac_svc_handler  // Get the next frame.
     cmp     r0, r4          // Is this call is synchronous (same frame)?
-    it      ne
+    itt     ne
     addsne  sp, #32         // No, skip high registers pushed by STMDB.
+    movne   r4, r0          // Preserve the frame of the previous actor.
+    bl      ac_svc_handoff  // Get the frame of the activated actor if any.
+    cmp     r0, r4          // Is new frame allocated?
+    it      ne
+    subsne  sp, #32         // Yes, simulate STMDB with high regs.
     b       exc_return    
+.endif
 
 /*
  * We came here with R0 pointing to the stack frame. The high registers
@@ -100,7 +204,17 @@ ac_port_svc_entry:
  */
 
 exc_return:
+.ifdef AC_PORT_FPU
+    ldmia   sp!, { r3-r11, lr } // Load the high registers of the next actor.
+    tst     lr, #16         // Is the frame extended?
+    it      eq
+    vldmiaeq sp!, { s16-s31 } // Yes, load FP registers also.
+    and     r2, lr, #16     // Keep the frame type bit.
+    mvn     lr, #30         // 0xffffffe1 = return to handler, extended frame.
+    orr     lr, r2          // Basic frame if the bit is set.
+.else
     mvn     lr, #14         // 0xfffffff1 = return to handler. Adjusted later.
+.endif
     mrs     r1, psp         // Pre-read PSP as mrs isn't allows in IT block.
     tst     r0, #1          // Return to handler mode?
     ittee   ne
@@ -109,7 +223,9 @@ exc_return:
     moveq   r1, r0          // No, return to thread, overwrite PSP in r1.
     orreq   lr, #12         // LR = 0xfffffffd, 'return to thread using PSP'.
     msr     psp, r1         // Update the PSP.
+.ifndef AC_PORT_FPU
     ldmia   sp!, { r4-r11 } // Load the high registers of the next actor.
+.endif
     bx      lr              // Unstacking.
 
 /*
@@ -155,5 +271,7 @@ ac_kernel_start:
     adds    r1, #32         // Add frame size = top of stack.
     mov     sp, r1
     svc     0
-    b       .
+idle:
+    wfi                     // Sleep until the next interrupt.
+    b       idle
 
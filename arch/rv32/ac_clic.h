@@ -0,0 +1,81 @@
+/*
+ *  @file   ac_clic.h
+ *  @brief  RISC-V Core-Local Interrupt Controller (CLIC) helpers.
+ *
+ *  Design description:
+ *  Used along with AC_PORT_CLIC instead of the software GPIC. Each actor
+ *  vector is a CLIC interrupt whose level is the actor's priority, so
+ *  preemption and priority unstacking are performed by the hardware.
+ *  Actor vectors are edge-triggered to be requested by software, the pending
+ *  bit is cleared by the handler since non-vectored mode doesn't clear it.
+ *  All the levels bits of clicintctl are used as the level, so actor
+ *  priorities must be less than MG_PRIO_MAX and non-actor interrupts such
+ *  as the tick must use higher levels. The interrupt is taken only when its
+ *  level is above the threshold which is zero in the idle loop, so actors 
+ *  can't have zero priority.
+ */
+
+#ifndef AC_CLIC_H
+#define AC_CLIC_H
+
+#include <assert.h>
+#include <stdint.h>
+
+#ifndef AC_CLIC_BASE
+#error AC_CLIC_BASE is not defined.
+#endif
+
+enum {
+    AC_CLIC_CFG_NLBITS = 8 << 1,        /* cliccfg.nlbits = 8 */
+    AC_CLIC_ATTR_EDGE = 1 << 1,         /* positive edge-triggered */
+    AC_CLIC_MTVEC_MODE = 3,
+    AC_CLIC_LEVEL_MAX = 0xff,
+};
+
+struct ac_clic_int_t {
+    volatile uint8_t ip;
+    volatile uint8_t ie;
+    volatile uint8_t attr;
+    volatile uint8_t ctl;
+};
+
+static inline struct ac_clic_int_t* ac_clic_int(unsigned int vect) {
+    struct ac_clic_int_t* const table = (void*) (AC_CLIC_BASE + 0x1000u);
+    return &table[vect];
+}
+
+//
+// Should be called before any interrupt is enabled. The trap entry should
+// be set by the application as mtvec = ac_port_intr_entry | AC_CLIC_MTVEC_MODE.
+//
+static inline void ac_clic_init(void) {
+    volatile uint8_t* const cliccfg = (void*) (AC_CLIC_BASE);
+    *cliccfg = AC_CLIC_CFG_NLBITS;
+}
+
+static inline void ac_clic_enable(unsigned int vect, unsigned int level) {
+    struct ac_clic_int_t* const irq = ac_clic_int(vect);
+    assert(level > 0 && level <= AC_CLIC_LEVEL_MAX);
+    irq->attr = AC_CLIC_ATTR_EDGE;
+    irq->ctl = level;
+    irq->ip = 0;
+    irq->ie = 1;
+}
+
+static inline unsigned int ac_clic_level(unsigned int vect) {
+    return ac_clic_int(vect)->ctl;
+}
+
+static inline void ac_clic_request(unsigned int vect) {
+    ac_clic_int(vect)->ip = 1;
+}
+
+//
+// Acknowledges the interrupt taken, the next request of the same vector
+// while the actor is running is taken after the actor's completion.
+//
+static inline void ac_clic_start(unsigned int vect) {
+    ac_clic_int(vect)->ip = 0;
+}
+
+#endif
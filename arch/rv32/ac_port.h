@@ -1,6 +1,13 @@
 /* 
  *  @file   ac_port.h
  *  @brief  RISCV32 hardware abstraction layer for the Actinium framework.
+ *
+ *  Design notes:
+ *  - When built with AC_PORT_CLIC (traps.s needs the same assembler symbol)
+ *    mtvec is expected in CLIC mode and actor priorities are CLIC interrupt
+ *    levels. Level mask is the interrupt threshold like BASEPRI on ARM, so
+ *    actors run at level 0 and are preempted by the hardware. Saved frames
+ *    hold mcause since its previous level field is restored by mret.
  */
 
 #ifndef AC_PORT_H
@@ -12,11 +19,16 @@
 #include <assert.h>
 #include "mg_port.h"
 
+#ifndef AC_PORT_CLIC
+#define AC_PORT_CLIC 0
+#endif
+
 enum {
     AC_PORT_REGION_FLASH,
     AC_PORT_REGION_SRAM,
     AC_PORT_REGION_STACK,
-    AC_PORT_REGIONS_NUM
+    AC_PORT_REGIONS_NUM,
+    AC_PORT_REGIONS_MAX = 8,
 };
 
 enum {
@@ -60,15 +72,23 @@ enum {
 // does not contain callee-saved registers, so register array contains only
 // 16 registers instead of 31. Registers are saved in the following order:
 // x1,x5-x7,x10-x11,x12-x17,x28-x31 then rest of the frame x2-x4,x8-x9,x18-x27.
+// Synchronous syscalls from U-mode use the full-sized frame but fill only
+// mstatus, pc, ra, a0 and sp, the rest of registers is never restored from it.
 // Saved mstatus must have MIE=0 and MPIE=1 to avoid interrupts during 
-// context switch.
+// context switch. In CLIC mode mcause is restored before mstatus, since its
+// MPP and MPIE fields are aliases of mstatus ones.
 //
 
 struct ac_port_frame_t {
     uint32_t mstatus;
     uint32_t pc;
     uint32_t r[31];
+#if AC_PORT_CLIC
+    uint32_t mcause;
+    uint32_t padding[2];    /* for stack alignment */
+#else
     uint32_t padding[3];    /* for stack alignment */
+#endif
 };
 
 static inline struct ac_port_frame_t* ac_port_frame_alloc(
@@ -81,6 +101,9 @@ static inline struct ac_port_frame_t* ac_port_frame_alloc(
     frame->mstatus = MPIE_BIT;
     frame->r[REG_RA] = (uint32_t) restart_marker;
     frame->r[REG_SP] = base;
+#if AC_PORT_CLIC
+    frame->mcause = 0;      /* actors run at level 0 above the threshold */
+#endif
     return frame;
 }
 
@@ -91,7 +114,21 @@ static inline void ac_port_frame_set_arg(
 }
 
 static inline void ac_port_level_mask(unsigned int level) {
+#if AC_PORT_CLIC
+    asm volatile ("csrw 0x347, %0" : : "r" (level)); /* mintthresh */
+#else
     (void) level;
+#endif
+}
+
+//
+// Trap handler runs with interrupts enabled, so actors activated inside the
+// syscall preempt it as nested interrupts right away. There is nothing left
+// to claim for the direct handoff.
+//
+static inline bool ac_port_intr_claim(unsigned int* vect) {
+    (void) vect;
+    return false;
 }
 
 enum {
@@ -105,9 +142,15 @@ struct ac_port_region_t {
     uint32_t attr;
 };
 
-static inline void ac_port_init(size_t size, struct ac_port_region_t* idle) {
-    (void) size;
-    (void) idle;
+//
+// Region images don't contain the region number, nothing to precompute.
+//
+static inline void ac_port_region_ids_init(
+    size_t sz, 
+    struct ac_port_region_t* regions
+) {
+    (void) sz;
+    (void) regions;
 }
 
 static inline void ac_port_region_init(
@@ -120,32 +163,21 @@ static inline void ac_port_region_init(
     region->attr = attr;
 }
 
+//
+// Swaps the images of two regions, used by the message slots.
+//
+static inline void ac_port_region_swap(
+    struct ac_port_region_t* a, 
+    struct ac_port_region_t* b
+) {
+    const struct ac_port_region_t temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
 #define ac_port_csrr(csr, data) asm volatile ("csrr %0, " #csr : "=r" (data))
 #define ac_port_csrw(csr, data) asm volatile ("csrw " #csr ", %0" : : "r" (data))
 
-static void ac_pmp_update_entry(unsigned i, uint32_t addr, uint32_t attr) {
-    uint32_t pmpcfg[2];
-    uint8_t* bytes = (uint8_t*) &pmpcfg[0];
-
-    ac_port_csrr(pmpcfg0, pmpcfg[0]);
-    ac_port_csrr(pmpcfg1, pmpcfg[1]);
-    bytes[i] = attr;
-    ac_port_csrw(pmpcfg0, pmpcfg[0]);
-    ac_port_csrw(pmpcfg1, pmpcfg[1]); 
-
-    switch (i) {
-        case 0: ac_port_csrw(pmpaddr0, addr); break;
-        case 1: ac_port_csrw(pmpaddr1, addr); break;
-        case 2: ac_port_csrw(pmpaddr2, addr); break;
-        case 3: ac_port_csrw(pmpaddr3, addr); break;
-        case 4: ac_port_csrw(pmpaddr4, addr); break;
-        case 5: ac_port_csrw(pmpaddr5, addr); break;
-        case 6: ac_port_csrw(pmpaddr6, addr); break;
-        case 7: ac_port_csrw(pmpaddr7, addr); break;
-        default: break;
-    }
-}
-
 static void ac_pmp_reprogram(unsigned sz, const struct ac_port_region_t* regions) {
     uint32_t pmpcfg[2];
     uint8_t* bytes = (uint8_t*) &pmpcfg[0];
@@ -176,23 +208,96 @@ static void ac_pmp_reprogram(unsigned sz, const struct ac_port_region_t* regions
     ac_port_csrw(pmpcfg1, pmpcfg[1]);    
 }
 
-static inline void ac_port_update_region(
-    unsigned int i, 
-    const struct ac_port_region_t* region
+static inline void ac_port_mpu_reprogram(
+    size_t sz, 
+    const struct ac_port_region_t* regions
 ) {
     mg_critical_section_enter();
-    ac_pmp_update_entry(i, region->pmpaddr, region->attr);
+    ac_pmp_reprogram(sz, regions);
     mg_critical_section_leave();
 }
 
-static inline void ac_port_mpu_reprogram(
+//
+// Idle regions are loaded, so the kernel's shadow of them matches the PMP.
+//
+static inline void ac_port_init(size_t size, struct ac_port_region_t* idle) {
+    ac_port_mpu_reprogram(size, idle);
+    ac_port_level_mask(0);
+}
+
+//
+// Builds the configuration word of 4 entries from the attributes of the 
+// loaded regions. Entries above the specified number are taken from the 
+// register value.
+//
+static inline uint32_t ac_pmp_cfg_merge(
+    uint32_t cfg, 
+    size_t first,
+    size_t sz, 
+    const struct ac_port_region_t* loaded
+) {
+    for (size_t i = first; i < first + 4 && i < sz; ++i) {
+        const unsigned int shift = (i - first) * 8;
+        cfg = (cfg & ~(UINT32_C(0xff) << shift)) | ((loaded[i].attr & 0xffu) << shift);
+    }
+
+    return cfg;
+}
+
+#define AC_PMP_ENTRY_UPDATE(n) \
+    if ((n) < sz) { \
+        if (loaded[n].pmpaddr != regions[n].pmpaddr) { \
+            ac_port_csrw(pmpaddr##n, regions[n].pmpaddr); \
+        } \
+        cfg_changed |= (uint32_t) (loaded[n].attr != regions[n].attr) << ((n) / 4); \
+        loaded[n] = regions[n]; \
+    }
+
+//
+// Writes only the entries which differ from the loaded ones. The loaded 
+// regions are the shadow of PMP registers, so configuration words are not 
+// read back and each of them is written only if some attribute within it has
+// changed. The message region has its fixed entry, so message exchange is 
+// the single pmpaddr write. Entries are unrolled to avoid CSR dispatch.
+//
+static inline void ac_port_mpu_update(
     size_t sz, 
+    struct ac_port_region_t* loaded,
     const struct ac_port_region_t* regions
 ) {
+    uint32_t cfg_changed = 0;
+    uint32_t cfg = 0;
+
     mg_critical_section_enter();
-    ac_pmp_reprogram(sz, regions);
+    AC_PMP_ENTRY_UPDATE(0);
+    AC_PMP_ENTRY_UPDATE(1);
+    AC_PMP_ENTRY_UPDATE(2);
+    AC_PMP_ENTRY_UPDATE(3);
+    AC_PMP_ENTRY_UPDATE(4);
+    AC_PMP_ENTRY_UPDATE(5);
+    AC_PMP_ENTRY_UPDATE(6);
+    AC_PMP_ENTRY_UPDATE(7);
+
+    if (cfg_changed & 1) {
+        if (sz < 4) {
+            ac_port_csrr(pmpcfg0, cfg);
+        }
+
+        ac_port_csrw(pmpcfg0, ac_pmp_cfg_merge(cfg, 0, sz, loaded));
+    }
+
+    if (cfg_changed & 2) {
+        if (sz < 8) {
+            ac_port_csrr(pmpcfg1, cfg);
+        }
+
+        ac_port_csrw(pmpcfg1, ac_pmp_cfg_merge(cfg, 4, sz, loaded));
+    }
+
     mg_critical_section_leave();
 }
 
+#undef AC_PMP_ENTRY_UPDATE
+
 #endif
 
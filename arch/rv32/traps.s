@@ -6,14 +6,19 @@
 .extern ac_port_msi_handler
 .extern ac_port_mtimer_handler
 .extern ac_port_mei_handler
+.extern ac_port_clic_handler
 
 .global ac_kernel_start
 .global ac_port_intr_entry
+.ifndef AC_PORT_CLIC
+.global ac_port_vectors
+.endif
 
 .set FRAME_SZ,144
 .set MSTATUS_MIE,8
 .set IDLE_STACK_SIZE,256
 
+.ifndef AC_PORT_CLIC
 .section .rodata
 .align 4
 
@@ -30,21 +35,19 @@ internal_vectors:
 .word       0
 .word       0
 .word       ac_port_mei_handler
+.endif
 
 .section .text
+.ifdef AC_PORT_CLIC
+.align 6                            /* CLIC mode mtvec base alignment */
+.else
 .align 4
+.endif
 
-/* 
- * mscratch = top of kernel stack when CPU is in U-mode and is zero in M-mode.
+/*
+ * Saves callee-saved registers of the preempted actor and its stack pointer.
  */
-ac_port_intr_entry:
-    csrrw   sp, mscratch, sp
-    bnez    sp, from_umode          /* SP = kernel stack if prev mode is U */
-    csrrw   sp, mscratch, zero      /* switch SP back is prev mode is M */
-    addi    sp, sp, -FRAME_SZ
-    j       save_frame
-from_umode:
-    addi    sp, sp, -FRAME_SZ
+.macro user_regs_save
     sw      s11, 32*4(sp)           /* save persistent user regs on kstack */
     sw      s10, 31*4(sp)
     sw      s9,  30*4(sp)
@@ -61,7 +64,9 @@ from_umode:
     sw      gp,  19*4(sp)
     csrrw   s0, mscratch, zero      /* s0 = top of user stack */
     sw      s0,  18*4(sp)
-save_frame:                         /* save volatile registers */
+.endm
+
+.macro volatile_regs_save
     sw      t6, 17*4(sp)
     sw      t5, 16*4(sp)
     sw      t4, 15*4(sp)
@@ -82,22 +87,118 @@ save_frame:                         /* save volatile registers */
     csrr    t1, mstatus
     sw      t0, 1*4(sp)
     sw      t1, 0*4(sp)
+.endm
+
+/* 
+ * mscratch = top of kernel stack when CPU is in U-mode and is zero in M-mode.
+ */
+ac_port_intr_entry:
+    csrrw   sp, mscratch, sp
+    bnez    sp, from_umode          /* SP = kernel stack if prev mode is U */
+    csrrw   sp, mscratch, zero      /* switch SP back is prev mode is M */
+    addi    sp, sp, -FRAME_SZ
+    j       save_frame
+from_umode:
+    addi    sp, sp, -FRAME_SZ
+    sw      t0, 3*4(sp)
+    csrr    t0, mcause
+.ifdef AC_PORT_CLIC
+    bltz    t0, 1f                  /* interrupts are never syscalls */
+    slli    t0, t0, 20              /* CLIC mcause holds mpil, mpp, mpie too */
+    srli    t0, t0, 20
+.endif
+    addi    t0, t0, -8              /* environment call from U-mode */
+    beqz    t0, syscall_entry
+1:
+    lw      t0, 3*4(sp)
+    user_regs_save
+save_frame:                         /* save volatile registers */
+    volatile_regs_save
     mv      a0, sp                  /* pointer to the saved frame as 1st arg */
     csrr    a1, mcause
+.ifdef AC_PORT_CLIC
+    sw      a1, 33*4(sp)            /* previous interrupt level for mret */
+.endif
     bgez    a1, exception
 
 interrupt:
+.ifdef AC_PORT_CLIC
+    slli    a1, a1, 20              /* interrupt id as 2nd arg */
+    srli    a1, a1, 20
+    jal     ac_port_clic_handler
+.else
     slli    a1, a1, 2
     la      t0, internal_vectors
     add     t0, t0, a1
     lw      t0, (t0)
     jalr    t0
+.endif
     j       context_restore
 exception:
+.ifdef AC_PORT_CLIC
+    slli    a1, a1, 20              /* exception code as 2nd arg */
+    srli    a1, a1, 20
+.endif
     mv      s0, a0                  /* preserve the ptr to the syscall frame */
     jal     ac_port_trap_handler
     beq     a0, s0, context_restore
     addi    sp, s0, FRAME_SZ        /* skip the syscall frame on async call */
+    j       context_restore
+
+/*
+ * Syscall frame contains only mstatus, pc, ra, a0 and user sp. Callee-saved
+ * registers are preserved by the handler itself and the rest are clobbered
+ * by the syscall according to the calling convention. Async call completes
+ * the actor, so its frame is discarded and never has to be filled up.
+ */
+syscall_entry:
+    sw      ra, 2*4(sp)
+    sw      a0, 6*4(sp)
+    csrrw   t0, mscratch, zero      /* t0 = top of user stack */
+    sw      t0, 18*4(sp)
+    csrr    t0, mepc
+    sw      t0, 1*4(sp)
+    csrr    t0, mstatus
+    sw      t0, 0*4(sp)
+.ifdef AC_PORT_CLIC
+    csrr    t0, mcause
+    sw      t0, 33*4(sp)
+.endif
+    mv      a0, sp
+    li      a1, 8
+    jal     ac_port_trap_handler
+    beq     a0, sp, syscall_return
+    addi    sp, sp, FRAME_SZ        /* skip the syscall frame on async call */
+    j       context_restore
+syscall_return:                     /* MIE = 0, MPP = U */
+    lw      t0, 1*4(sp)
+    csrw    mepc, t0
+.ifdef AC_PORT_CLIC
+    lw      t0, 33*4(sp)
+    csrw    mcause, t0
+.endif
+    lw      t0, 0*4(sp)
+    csrw    mstatus, t0
+    addi    t0, sp, FRAME_SZ
+    csrw    mscratch, t0            /* save top of kernel stack to mscratch */
+    mv      t0, zero                /* don't leak kernel values to the actor */
+    mv      t1, zero
+    mv      t2, zero
+    mv      t3, zero
+    mv      t4, zero
+    mv      t5, zero
+    mv      t6, zero
+    mv      a1, zero
+    mv      a2, zero
+    mv      a3, zero
+    mv      a4, zero
+    mv      a5, zero
+    mv      a6, zero
+    mv      a7, zero
+    lw      ra, 2*4(sp)
+    lw      a0, 6*4(sp)
+    lw      sp, 18*4(sp)
+    mret
 
 context_restore:                    /* a0 points to context, MIE = 0 */
     lw      t6, 17*4(a0)            /* load volatile registers except a0/t0 */
@@ -116,6 +217,10 @@ context_restore:                    /* a0 points to context, MIE = 0 */
     lw      ra, 2*4(a0)
     lw      t0, 1*4(a0)
     csrw    mepc, t0
+.ifdef AC_PORT_CLIC
+    lw      t0, 33*4(a0)            /* before mstatus, MPP/MPIE are aliased */
+    csrw    mcause, t0
+.endif
     lw      t0, 0*4(a0)
     csrw    mstatus, t0
     srli    t0, t0, 11              /* MPP offset */
@@ -148,6 +253,54 @@ to_umode:
     lw      sp,  18*4(sp)           /* SP is updated using SP, last op */
     mret
 
+/*
+ * Entries of the vectored mode: interrupts are taken by their own entries
+ * which call the handlers directly, skipping the cause decoding. Exceptions
+ * and the ecall use the common entry.
+ */
+.macro vector_entry handler
+    csrrw   sp, mscratch, sp
+    bnez    sp, 1f
+    csrrw   sp, mscratch, zero
+    addi    sp, sp, -FRAME_SZ
+    j       2f
+1:
+    addi    sp, sp, -FRAME_SZ
+    user_regs_save
+2:
+    volatile_regs_save
+    mv      a0, sp
+    jal     \handler
+    j       context_restore
+.endm
+
+.ifndef AC_PORT_CLIC
+msi_entry:
+    vector_entry ac_port_msi_handler
+mtimer_entry:
+    vector_entry ac_port_mtimer_handler
+mei_entry:
+    vector_entry ac_port_mei_handler
+
+/*
+ * mtvec = ac_port_vectors | 1 selects the vectored mode.
+ */
+.align 6
+ac_port_vectors:
+    j       ac_port_intr_entry      /* exceptions */
+    j       ac_port_intr_entry
+    j       ac_port_intr_entry
+    j       msi_entry
+    j       ac_port_intr_entry
+    j       ac_port_intr_entry
+    j       ac_port_intr_entry
+    j       mtimer_entry
+    j       ac_port_intr_entry
+    j       ac_port_intr_entry
+    j       ac_port_intr_entry
+    j       mei_entry
+.endif
+
 ac_kernel_start:
     csrs    mstatus, MSTATUS_MIE
 wait:    
@@ -10,6 +10,7 @@
 #define AC_CORE_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <assert.h>
 #include <setjmp.h>
 #include "actinium.h"
@@ -20,23 +21,133 @@
 unsigned g_req;
 static struct ac_gpic_t g_pic;
 
+//
+// Number of the software interrupt entries and the direct handoff switch.
+// Used by tests to measure how many interrupt round trips are avoided.
+//
+unsigned g_swi_entries;
+bool g_handoff = true;
+
+//
+// Number of regions written by the MPU update.
+//
+unsigned g_region_writes;
+
+bool g_fpu_granted;
+unsigned g_fpu_grants;
+
+//
+// Lazy FP state preservation of the ARM ports. Exception entry of a context
+// with FP state leaves the save of its FP registers pending until the next 
+// FP instruction and the save uses the MPU regions loaded then. The kernel 
+// triggers it before the switch to another actor, so the number of saves is
+// counted there.
+//
+bool g_fp_lazy_pending;
+unsigned g_fp_lazy_saves;
+
+static void ac_port_exc_entry(void) {
+    g_fp_lazy_pending = g_fpu_granted;
+}
+
+void ac_port_fpu_lazy_save(void) {
+    if (g_fp_lazy_pending) {
+        g_fp_lazy_pending = false;
+        ++g_fp_lazy_saves;
+    }
+}
+
+//
+// Virtual time of the tickless mode. Tests advance the time and call the tick
+// when the programmed deadline is reached.
+//
+uint32_t g_time_now;
+uint32_t g_timer_deadline;
+bool g_timer_armed;
+
+#if AC_TICKLESS
+uint32_t ac_port_timer_now(void) {
+    return g_time_now;
+}
+
+void ac_port_timer_set(uint32_t deadline) {
+    g_timer_deadline = deadline;
+    g_timer_armed = true;
+}
+
+void ac_port_timer_stop(void) {
+    g_timer_armed = false;
+}
+#endif
+
 void pic_interrupt_request(unsigned cpu, unsigned vect) {
     ac_gpic_request(&g_pic, vect);
 }
 
 void* _ac_syscall(unsigned arg);
 
+//
+// Takes an unmasked vector on behalf of the syscall. The vector is completed
+// by the same means as the one started inside the interrupt handler.
+//
+bool ac_port_intr_claim(unsigned int* vect) {
+    if (!g_handoff || !ac_gpic_unmasked(&g_pic)) {
+        return false;
+    }
+
+    *vect = ac_gpic_start(&g_pic);
+    return true;
+}
+
+//
+// Runs the activated actor when returned frame does not match the previous 
+// one. Privileged actors are called inside the kernel, so returned frame is 
+// the same as the argument passed. Otherwise preemption occurs. In that case
+// the context is saved using setjmp and the new actor is activated.
+// Returned frame is used just for parameter passing.
+// Actors pending after the completion are tail-chained in place of the 
+// completed one like the ports do inside the asynchronous syscall.
+//
+static void ac_port_actor_run(
+    struct ac_port_frame_t* prev, 
+    struct ac_port_frame_t* frame
+) {
+    unsigned int active = 0;
+
+    do {
+        if (prev != frame) {
+            void* arg = frame->arg;
+            uint32_t (* const func)(void*) = frame->func;
+
+            //
+            // Preemption case. It is assumed that actor will exit via either 
+            // async syscall inside its function or exception. Both cases lead
+            // to longjmp back here and completion of the vector. Synchronously
+            // completed calls return the message for the next invocation like
+            // usermode startup code does.
+            //
+            if (!setjmp(prev->context)) {
+                for (;;) {
+                    const uint32_t syscall = func(arg);
+                    arg = _ac_syscall(syscall);
+                }
+            }
+        }
+
+        ac_gpic_done(&g_pic);
+        active = ac_gpic_bitmap_top(&g_pic.active);
+        frame = _ac_svc_handoff(prev);
+    } while (ac_gpic_bitmap_top(&g_pic.active) != active);
+}
+
 //
 // Asynchronous actor preemption/activation handler.
 // There may be two kinds of actors privileged and unprivileged ones.
-// Privileged actors are called inside the ac_intr_handler function, so 
-// returned frame is the same as the argument passed. When returned
-// value does not match the parameter it means that preemption occurs. In that
-// case the context is saved using setjmp and the new actor is activated.
-// Returned frame is used just for parameter passing.
 //
 void ac_port_swi_handler(void) {
+    ac_port_exc_entry();
     const unsigned vect = ac_gpic_start(&g_pic);
+    ++g_swi_entries;
 
     //
     // Create the new 'interrupt frame' on stack and call the kernel.
@@ -44,32 +155,7 @@ void ac_port_swi_handler(void) {
     // as 'preempted context'.
     //
     struct ac_port_frame_t temp;
-    struct ac_port_frame_t* const frame = _ac_intr_handler(vect, &temp);
-    
-    if (&temp != frame) {
-        void* const arg = frame->arg;
-        uint32_t (* const func)(void*) = frame->func;
-
-        //
-        // Preemption case. It is assumed that actor will exit via either 
-        // async syscall inside its function or exception. Both cases lead to
-        // longjmp and execution of the 'else' branch.
-        //
-        if (!setjmp(temp.context)) {
-            for (;;) {
-                const uint32_t syscall = func(arg);
-                _ac_syscall(syscall);
-            }
-        } else {
-
-            //
-            // This branch is executed when the actor is completed.
-            //
-            ac_gpic_done(&g_pic);
-        }
-    } else {
-        ac_gpic_done(&g_pic); 
-    }
+    ac_port_actor_run(&temp, _ac_intr_handler(vect, &temp));
 
     //
     // Actor completion may unblock some other actors.
@@ -90,16 +176,9 @@ void* _ac_syscall(unsigned arg) {
     // they return to the caller.
     //
     struct ac_port_frame_t temp;
+    temp.arg = 0;
+    ac_port_exc_entry();
     struct ac_port_frame_t* const next_frame = _ac_svc_handler(arg, &temp);
-    void* result = 0;
-
-    //
-    // Synchronous syscalls may activate another actors i.e. by posting mesage
-    // into a channel.
-    //
-    if (g_req) {        
-        ac_port_swi_handler();
-    }
 
     //
     // Returning non-local frame means asynchronous call and actor completion.
@@ -107,8 +186,24 @@ void* _ac_syscall(unsigned arg) {
     //
     if (&temp != next_frame) {
         longjmp(next_frame->context, 0);
-    } else {
-        result = temp.arg;
+    }
+
+    void* const result = temp.arg;
+
+    //
+    // Synchronous syscalls may activate another actors i.e. by posting mesage
+    // into a channel. Outranking actor is started right inside the syscall,
+    // the rest is left to the interrupt handler.
+    //
+    const unsigned int active = ac_gpic_bitmap_top(&g_pic.active);
+    struct ac_port_frame_t* const frame = _ac_svc_handoff(&temp);
+
+    if (ac_gpic_bitmap_top(&g_pic.active) != active) {
+        ac_port_actor_run(&temp, frame);
+    }
+
+    if (g_req) {        
+        ac_port_swi_handler();
     }
 
     return result;
@@ -5,10 +5,13 @@
  *
  *  Design description:
  *  This is a pure software implementation compatible with any interrupt
- *  controller. The module maintains 32 'vectors' available for actor execution.
- *  These vectors are represented as three dwords: masked, pending, active.
- *  A single software IRQ is used as a workhorse for the preemption: 
- *  whenever there is unmasked vector the AC_GPIC_REQUEST is used to request 
+ *  controller. The module maintains up to 1024 'vectors' available for actor
+ *  execution, 32 by default. Pending and active vectors are represented as
+ *  two-level bitmaps: a summary word tells which words of the bitmap are
+ *  nonzero, so the highest vector is found by two CLZs regardless of the
+ *  number of vectors. Mask is the number of the lowest vectors masked.
+ *  A single software IRQ is used as a workhorse for the preemption:
+ *  whenever there is unmasked vector the AC_GPIC_REQUEST is used to request
  *  underlying software interrupt. Pending bits are reset upon entering
  *  the interrupt handler.
  */
@@ -16,6 +19,7 @@
 #ifndef AC_GPIC_H
 #define AC_GPIC_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #ifndef AC_GPIC_CLZ
@@ -26,84 +30,109 @@
 #error AC_GPIC_REQUEST(set) is not defined.
 #endif
 
-typedef uint32_t ac_gpic_mask_t;
+#ifndef AC_GPIC_PRIO_NUM
+#define AC_GPIC_PRIO_NUM 32
+#endif
+
+typedef unsigned int ac_gpic_mask_t;
 
 enum {
-    AC_GPIC_PRIO_MAX = 31,
+    AC_GPIC_PRIO_MAX = AC_GPIC_PRIO_NUM - 1,
     AC_GPIC_PRIO_MIN = 0,
+    AC_GPIC_WORDS = (AC_GPIC_PRIO_NUM + 31) / 32,
 };
 
+_Static_assert(AC_GPIC_WORDS <= 32, "too many gpic vectors");
+
 static inline unsigned int lg2(uint32_t v) {
     return 31 - AC_GPIC_CLZ(v);
 }
 
+struct ac_gpic_bitmap_t {
+    volatile uint32_t summary;
+    volatile uint32_t bits[AC_GPIC_WORDS];
+};
+
+struct ac_gpic_t {
+    volatile ac_gpic_mask_t mask;
+    struct ac_gpic_bitmap_t pending;
+    struct ac_gpic_bitmap_t active;
+};
+
+static inline void ac_gpic_bitmap_set(struct ac_gpic_bitmap_t* map, unsigned int v) {
+    map->bits[v / 32] |= UINT32_C(1) << (v % 32);
+    map->summary |= UINT32_C(1) << (v / 32);
+}
+
+static inline void ac_gpic_bitmap_clear(struct ac_gpic_bitmap_t* map, unsigned int v) {
+    const uint32_t bits = map->bits[v / 32] & ~(UINT32_C(1) << (v % 32));
+    map->bits[v / 32] = bits;
+
+    if (bits == 0) {
+        map->summary &= ~(UINT32_C(1) << (v / 32));
+    }
+}
+
 //
-// Fills bits lower than MSB with ones:
-// i.e. 00001010 became 00001111,
-//      00101110 became 00111111, etc.
-// equivalent: (1 << (log2(x) + 1)) - 1
+// Returns the highest vector plus one, zero when the bitmap is empty. So the
+// result is directly comparable with the mask.
 //
-static inline uint32_t fill_bits(uint32_t v) {
-    v |= v >> 1;
-    v |= v >> 2;
-    v |= v >> 4;
-    v |= v >> 8;
-    v |= v >> 16;
-
-    return v;
+static inline unsigned int ac_gpic_bitmap_top(const struct ac_gpic_bitmap_t* map) {
+    const uint32_t summary = map->summary;
+
+    if (summary == 0) {
+        return 0;
+    }
+
+    const unsigned int word = lg2(summary);
+    return word * 32 + lg2(map->bits[word]) + 1;
 }
 
-struct ac_gpic_t {
-    volatile uint32_t mask;
-    volatile uint32_t pending;
-    volatile uint32_t active;
-};
+static inline bool ac_gpic_unmasked(const struct ac_gpic_t* pic) {
+    return ac_gpic_bitmap_top(&pic->pending) > pic->mask;
+}
 
 static inline void ac_gpic_request(struct ac_gpic_t* pic, unsigned int vect) {
-    const uint32_t new_pending = pic->pending | (UINT32_C(1) << vect);
-    pic->pending = new_pending;
-    
-    if ((~pic->mask) & new_pending) {
+    ac_gpic_bitmap_set(&pic->pending, vect);
+
+    if (ac_gpic_unmasked(pic)) {
         AC_GPIC_REQUEST(1);
     }
 }
 
-static inline uint32_t ac_gpic_mask(struct ac_gpic_t* pic, unsigned int prio) {
-    const uint32_t mask = (((UINT32_C(1) << prio) - 1) << 1) | 1;
-    const uint32_t old_mask = pic->mask;
-    pic->mask = mask;
+static inline ac_gpic_mask_t ac_gpic_mask(struct ac_gpic_t* pic, unsigned int prio) {
+    const ac_gpic_mask_t old_mask = pic->mask;
+    pic->mask = prio + 1;
     AC_GPIC_REQUEST(0);
 
     return old_mask;
 }
 
-static inline void ac_gpic_unmask(struct ac_gpic_t* pic, uint32_t new_mask) {
+static inline void ac_gpic_unmask(struct ac_gpic_t* pic, ac_gpic_mask_t new_mask) {
     pic->mask = new_mask;
-    
-    if ((~new_mask) & pic->pending) {
+
+    if (ac_gpic_unmasked(pic)) {
         AC_GPIC_REQUEST(1);
     }
 }
 
 static inline unsigned int ac_gpic_start(struct ac_gpic_t* pic) {
-    const uint32_t unmasked = (~pic->mask) & pic->pending;
-    const unsigned int vect = lg2(unmasked);
-    const uint32_t mask = UINT32_C(1) << vect;
+    const unsigned int vect = ac_gpic_bitmap_top(&pic->pending) - 1;
     ac_gpic_mask(pic, vect);
-    pic->pending &= ~mask;
-    pic->active |= mask;
+    ac_gpic_bitmap_clear(&pic->pending, vect);
+    ac_gpic_bitmap_set(&pic->active, vect);
 
     return vect;
 }
 
 static inline void ac_gpic_done(struct ac_gpic_t* pic) {
-    const uint32_t active = pic->active;
-    const uint32_t ones_except_msb = fill_bits(active) >> 1;
-    const uint32_t new_active = active & ones_except_msb;
-    const uint32_t prev_mask = fill_bits(new_active);
-    pic->active = new_active;
-    ac_gpic_unmask(pic, prev_mask);
+    const unsigned int top = ac_gpic_bitmap_top(&pic->active);
+
+    if (top != 0) {
+        ac_gpic_bitmap_clear(&pic->active, top - 1);
+    }
+
+    ac_gpic_unmask(pic, ac_gpic_bitmap_top(&pic->active));
 }
 
 #endif
-
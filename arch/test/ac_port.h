@@ -16,7 +16,8 @@ enum {
     AC_PORT_REGION_FLASH,
     AC_PORT_REGION_SRAM,
     AC_PORT_REGION_STACK,
-    AC_PORT_REGIONS_NUM
+    AC_PORT_REGIONS_NUM,
+    AC_PORT_REGIONS_MAX = 16,
 };
 
 struct ac_port_frame_t {
@@ -55,23 +56,43 @@ enum {
 };
 
 struct ac_port_region_t {
-    uint32_t addr;
+    uintptr_t addr;
+    size_t size;
+    unsigned int attr;
 };
 
+//
+// Region images don't contain the region number, nothing to precompute.
+//
+static inline void ac_port_region_ids_init(
+    size_t sz, 
+    struct ac_port_region_t* regions
+) {
+    (void) sz;
+    (void) regions;
+}
+
 static inline void ac_port_region_init(
     struct ac_port_region_t* region, 
     uintptr_t addr, 
     size_t size,
     unsigned int attr
 ) {
-    /*TODO*/
+    region->addr = addr;
+    region->size = size;
+    region->attr = size ? attr : 0;
 }
 
-static inline void ac_port_update_region(
-    unsigned int i, 
-    struct ac_port_region_t* region
+//
+// Swaps the images of two regions, used by the message slots.
+//
+static inline void ac_port_region_swap(
+    struct ac_port_region_t* a, 
+    struct ac_port_region_t* b
 ) {
-    /*TODO*/
+    const struct ac_port_region_t temp = *a;
+    *a = *b;
+    *b = temp;
 }
 
 static inline void ac_port_mpu_reprogram(
@@ -81,6 +102,51 @@ static inline void ac_port_mpu_reprogram(
     /*TODO*/
 }
 
+//
+// Counts region writes instead of programming the hardware, so tests can
+// check that unchanged regions are skipped. Stack region may not change while
+// the lazy FP save of the interrupted context is pending.
+//
+static inline void ac_port_mpu_update(
+    size_t sz, 
+    struct ac_port_region_t* loaded,
+    const struct ac_port_region_t* regions
+) {
+    extern unsigned g_region_writes;
+    extern bool g_fp_lazy_pending;
+
+    for (size_t i = 0; i < sz; ++i) {
+        const bool same = (loaded[i].addr == regions[i].addr) && 
+            (loaded[i].size == regions[i].size) && 
+            (loaded[i].attr == regions[i].attr);
+
+        if (!same) {
+            assert(!g_fp_lazy_pending || i != AC_PORT_REGION_STACK);
+            loaded[i] = regions[i];
+            ++g_region_writes;
+        }
+    }
+}
+
+//
+// FPU access granted to the running actor and the number of grant changes.
+//
+static inline void ac_port_fpu_grant(bool enabled) {
+    extern bool g_fpu_granted;
+    extern unsigned g_fpu_grants;
+    extern bool g_fp_lazy_pending;
+    assert(!g_fp_lazy_pending);
+    g_fpu_granted = enabled;
+    ++g_fpu_grants;
+}
+
+extern void ac_port_fpu_lazy_save(void);
+
+static inline void ac_port_fpu_lazy_drop(void) {
+    extern bool g_fp_lazy_pending;
+    g_fp_lazy_pending = false;
+}
+
 static inline void ac_port_init(
     size_t sz, 
     struct ac_port_region_t regions[static sz]
@@ -89,6 +155,7 @@ static inline void ac_port_init(
 }
 
 void ac_port_swi_handler(void);
+bool ac_port_intr_claim(unsigned int* vect);
 
 #endif
 
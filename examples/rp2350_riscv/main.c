@@ -12,6 +12,7 @@
 #include <hardware/structs/iobank0.h>
 #include <hardware/structs/padsbank0.h>
 #include <hardware/structs/accessctrl.h>
+#include <hardware/structs/ticks.h>
 #include "mtimer.h"
 #include "led_msg.h"
 #include "actinium.h"
@@ -28,6 +29,7 @@ enum {
     SPARE_IRQ_MAX = 51,
     GPIO_LED = 25,
     STACK_SZ = 1024,
+    CLK_PER_US = 12,
 };
 
 static noreturn void panic(void) {
@@ -122,7 +124,13 @@ noreturn int main(void) {
     accessctrl_hw->gpio_nsmask[0] = ~0u;
     sio_hw->mtime_ctrl &= ~1u;
     riscv_timer_set_mtime(0);
+#if AC_TIMER_US
+    ticks_hw->ticks[TICK_RISCV].cycles = CLK_PER_US;
+    ticks_hw->ticks[TICK_RISCV].ctrl = 1;
+    sio_hw->mtime_ctrl |= 1;
+#else
     sio_hw->mtime_ctrl |= 1 | (1 << 1);
+#endif
 
     extern void ac_port_intr_entry(void);
     extern uint32_t _estack1;
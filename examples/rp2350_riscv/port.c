@@ -5,7 +5,8 @@
  * Design notes:
  * Since it is impossible to send arbitrary interrupts to another CPU the
  * process is two-staged: 
- * - Target irq is saved inside a per-CPU bitmask.
+ * - Target irq is saved inside a per-CPU bitmask, the summary word tells
+ *   which words of the bitmask are nonzero.
  * - Inter-processor doorbell interrupt is requested.
  * - The doorbell handler on the target CPU translates bits back to the vectors.
  * - Local interrupt is requested on the target CPU inside a doorbell handler.
@@ -15,9 +16,15 @@
  * match the address.
  *
  * Mtimer and MSoftirq are not used.
+ *
+ * Timer interrupt is taken from the local IRQ_MTIMER of the controller. With
+ * the microsecond timer mtime is clocked by the 1 us RISC-V tick and mtimecmp
+ * is programmed by the kernel via the tickless hooks. The deadline given as 
+ * the low word is extended to the nearest 64-bit one.
  */
 
 #include <stdint.h>
+#include <hardware/platform_defs.h>
 #include <hardware/structs/sio.h>
 #include "mtimer.h"
 #include "actinium.h"
@@ -47,10 +54,20 @@ enum {
     IRQ_MTIMER = 29,
     MEI_MEIE = 1 << 11,
     CLK_PER_TICK = 12000,
-    IRQ_BITMAP_UINTS_COUNT = 2, /* Number of uints to hold all irq vectors.*/
+    IRQ_BITMAP_UINTS_COUNT = (NUM_IRQS + 31) / 32, /* to hold all irq vectors */
 };
 
+_Static_assert(IRQ_BITMAP_UINTS_COUNT <= 32, "summary word is too small");
+
+#if AC_TICKLESS && !AC_TIMER_US
+#error Tickless hooks are provided for the microsecond timer only.
+#endif
+
+/* PMP entry 7 denies the rest of the address space, see rp2350_per_cpu_init. */
+_Static_assert(AC_REGIONS_NUM <= 7, "PMP entry 7 is reserved, reduce AC_MSG_SLOTS");
+
 static atomic_uint g_ipi_request[IRQ_BITMAP_UINTS_COUNT][MG_CPU_MAX];
+static atomic_uint g_ipi_summary[MG_CPU_MAX];
 
 static inline void hazard3_local_irq_enable(unsigned vec) {
     uint32_t enabled_irqs = 0;
@@ -73,6 +90,7 @@ void pic_interrupt_request(unsigned cpu, unsigned vect) {
         const unsigned dword = vect / 32u;
         const unsigned bit = vect % 32u;
         (void) atomic_fetch_or(&g_ipi_request[dword][cpu], 1u << bit);
+        (void) atomic_fetch_or(&g_ipi_summary[cpu], 1u << dword);
         sio_hw->doorbell_out_set = 1;
     } else {
         hazard3_local_irq_request(vect);
@@ -82,9 +100,12 @@ void pic_interrupt_request(unsigned cpu, unsigned vect) {
 static inline void hazard3_doorbell_handler(void) {
     const unsigned cpu = mg_cpu_this();
     sio_hw->doorbell_in_clr = 1;
+    unsigned summary = atomic_exchange(&g_ipi_summary[cpu], 0);
 
-    for (unsigned i = 0; i < IRQ_BITMAP_UINTS_COUNT; ++i) {
+    while (summary) {
+        const unsigned i = 31u - mg_port_clz(summary);
         unsigned req = atomic_exchange(&g_ipi_request[i][cpu], 0);
+        summary &= ~(1u << i);
 
         while (req) {
             const unsigned bit = 31u - mg_port_clz(req);
@@ -107,9 +128,11 @@ static inline struct ac_port_frame_t* hazard3_local_irq_handler(
         hazard3_doorbell_handler();
         break;
     case IRQ_MTIMER:
+#if !AC_TICKLESS
         const uint64_t current = riscv_timer_get_mtime();
         const uint64_t next = current + CLK_PER_TICK;
         riscv_timer_set_mtimecmp(next);
+#endif
         ac_context_tick();
         break;
     default:
@@ -189,6 +212,22 @@ struct ac_port_frame_t* ac_port_msi_handler(struct ac_port_frame_t* prev) {
     return 0;
 }
 
+#if AC_TICKLESS
+uint32_t ac_port_timer_now(void) {
+    return (uint32_t) riscv_timer_get_mtime();
+}
+
+void ac_port_timer_set(uint32_t deadline) {
+    const uint64_t now = riscv_timer_get_mtime();
+    const int32_t delta = (int32_t) (deadline - (uint32_t) now);
+    riscv_timer_set_mtimecmp((delta > 0) ? (now + (uint32_t) delta) : now);
+}
+
+void ac_port_timer_stop(void) {
+    riscv_timer_set_mtimecmp(UINT64_MAX);
+}
+#endif
+
 unsigned pic_vect2prio(unsigned vec) {
     uint32_t prio_array = 0;
     const uint32_t offset = (vec % MEIPRA_PRIO_PER_WINDOW) * MEIPRA_BIT_PER_PRIO;
@@ -210,6 +249,10 @@ void rp2350_per_cpu_init(uint64_t actor_vects) {
         }
     }
 
+#if AC_TICKLESS
+    riscv_timer_set_mtimecmp(UINT64_MAX);
+#else
     riscv_timer_set_mtimecmp(CLK_PER_TICK);
+#endif
 }
 
@@ -0,0 +1,76 @@
+/*
+ *  @file   clic.c
+ *  @brief  Functions required by RISC-V platform in CLIC mode.
+ */
+
+#include <stdint.h>
+#include <assert.h>
+#include "actinium.h"
+#include "mtimer.h"
+#include "clic.h"
+
+#define MCAUSE_ENVCALL 8
+
+//
+// Priority of the actor vector is its CLIC level, so the levels are set up
+// before the actors are bound to the vectors. The tick has the highest level
+// and is level-triggered, the pending bit is reset by the next mtimecmp.
+//
+void clic_setup(void) {
+    ac_clic_init();
+    ac_clic_enable(CLIC_ACTOR_VECT, CLIC_ACTOR_LEVEL);
+    struct ac_clic_int_t* const timer = ac_clic_int(CLIC_MTIMER_VECT);
+    timer->ctl = AC_CLIC_LEVEL_MAX;
+    timer->ie = 1;
+}
+
+unsigned pic_vect2prio(unsigned vect) {
+    return ac_clic_level(vect);
+}
+
+void pic_interrupt_request(unsigned cpu, unsigned vect) {
+    ac_clic_request(vect);
+}
+
+//
+// All interrupts come here with their CLIC ids. Actors are preempted by the
+// hardware, so the handler just starts the next actor of the vector.
+//
+struct ac_port_frame_t* ac_port_clic_handler(
+    struct ac_port_frame_t* frame,
+    uint32_t id
+) {
+    if (id == CLIC_MTIMER_VECT) {
+        mtimer_setup();
+        mg_critical_section_leave();
+        ac_context_tick();
+        mg_critical_section_enter();
+        return frame;
+    }
+
+    ac_clic_start(id);
+    mg_critical_section_leave();
+    frame = _ac_intr_handler(id, frame);
+    mg_critical_section_enter();
+    return frame;
+}
+
+//
+// N.B. Synchronous syscalls return the same frame as input, otherwise it
+// is assumed that the call is asynchronous and the current actor is
+// completed. Actors pending after the completion are taken by the hardware
+// once the threshold of the previous frame is restored.
+//
+
+struct ac_port_frame_t* ac_port_trap_handler(
+    struct ac_port_frame_t* frame,
+    uint32_t mcause
+) {
+    mg_critical_section_leave();
+    const uint32_t syscall = frame->r[REG_A0];
+    struct ac_port_frame_t* const next_frame = (mcause == MCAUSE_ENVCALL) ?
+        (frame->pc += sizeof(uint32_t)), _ac_svc_handler(syscall, frame):
+        ac_actor_exception();
+    mg_critical_section_enter();
+    return next_frame;
+}
@@ -0,0 +1,21 @@
+/*
+ *  @file   clic.h
+ *  @brief  CLIC configuration of the example built with CLIC=1.
+ */
+
+#ifndef CLIC_H
+#define CLIC_H
+
+#ifndef AC_CLIC_BASE
+#define AC_CLIC_BASE 0x2800000u     /* Depends on the core. */
+#endif
+
+#include "ac_clic.h"
+
+enum {
+    CLIC_MTIMER_VECT = 7,
+    CLIC_ACTOR_VECT = 16,           /* The first local interrupt. */
+    CLIC_ACTOR_LEVEL = 1,
+};
+
+#endif
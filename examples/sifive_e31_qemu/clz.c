@@ -0,0 +1,25 @@
+/*
+ *  @file   clz.c
+ *  @brief  Software CLZ used by both ports of the example.
+ */
+
+#include <stdint.h>
+
+//
+// E31 doesn't support CLZ, so implement it manually.
+//
+unsigned int mg_port_clz(uint32_t v) {
+    uint32_t r = !v;
+    uint32_t c = (v < 0x00010000u) << 4;
+    r += c;
+    v <<= c;
+    c = (v < 0x01000000u) << 3;
+    r += c;
+    v <<= c;
+    c = (v < 0x10000000u) << 2;
+    r += c;
+    v <<= c;
+    c = (v >> 27) & 0x1e;
+    r += (0x55afu >> c) & 3;
+    return r;
+}
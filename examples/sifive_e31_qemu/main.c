@@ -11,6 +11,14 @@
 #include "serial.h"
 #include "mtimer.h"
 
+/* Both actors share the vector, in CLIC mode it is a local interrupt. */
+#if AC_PORT_CLIC
+#include "clic.h"
+#define ACTOR_VECT CLIC_ACTOR_VECT
+#else
+#define ACTOR_VECT 1
+#endif
+
 void __assert_func(const char *f, int line, const char *fn, const char *expr) {
     serial_out("assert:\r\n");
     serial_out(expr);
@@ -64,6 +72,7 @@ extern void mie_init(void);
 
 int main(void) {
     ac_context_init();
+    mie_init(); /* Vectors are set up before the actors are bound to them. */
 
     /* 
      * Both actors share the same priority so there's only one stack.
@@ -76,14 +85,13 @@ int main(void) {
     ac_channel_init(&g_chan[1]);
 
     static struct ac_actor_t g_receiver;
-    ac_actor_init(&g_receiver, 1, descr_by_id(0));
+    ac_actor_init(&g_receiver, ACTOR_VECT, descr_by_id(0));
     ac_actor_allow(&g_receiver, 32, (void*)SERIAL_BASE, AC_ATTR_DEV);
 
     static struct ac_actor_t g_sender;
-    ac_actor_init(&g_sender, 1, descr_by_id(1));
+    ac_actor_init(&g_sender, ACTOR_VECT, descr_by_id(1));
     ac_actor_allow(&g_sender, 32, (void*)SERIAL_BASE, AC_ATTR_DEV);
 
-    mie_init();
     mtimer_setup();
     ac_kernel_start(); /* Does not return. */
 
@@ -14,25 +14,6 @@
 
 #define MCAUSE_ENVCALL 8
 
-//
-// E31 doesn't support CLZ, so implement it manually.
-//
-unsigned int mg_port_clz(uint32_t v) {
-    uint32_t r = !v;
-    uint32_t c = (v < 0x00010000u) << 4;
-    r += c;
-    v <<= c;
-    c = (v < 0x01000000u) << 3;
-    r += c;
-    v <<= c;
-    c = (v < 0x10000000u) << 2;
-    r += c;
-    v <<= c;
-    c = (v >> 27) & 0x1e;
-    r += (0x55afu >> c) & 3;
-    return r;
-}
-
 //
 // sw-implemented fake 'interrupt controller' simulated in MS interrupt.
 //
@@ -65,45 +46,48 @@ struct ac_port_frame_t* ac_port_mtimer_handler(struct ac_port_frame_t* frame) {
 }
 
 //
-// N.B. Synchronous syscalls return the same frame as input, otherwise it
-// is assumed that the call is asynchronous and the current actor is
+// N.B. When returned frame is the same as parameter it means that called 
+// actors are completed synchronously so interrupt should be marked as
 // completed.
 //
 
-struct ac_port_frame_t* ac_port_trap_handler(
-    struct ac_port_frame_t* frame,
-    uint32_t mcause
-) {
+struct ac_port_frame_t* ac_port_msi_handler(struct ac_port_frame_t* prev) {
+    const unsigned vect = ac_gpic_start(&g_pic);
     mg_critical_section_leave();
-    const uint32_t syscall = frame->r[REG_A0];
-    struct ac_port_frame_t* const next_frame = (mcause == MCAUSE_ENVCALL) ?
-        (frame->pc += sizeof(uint32_t)), _ac_svc_handler(syscall, frame):
-        ac_actor_exception();
+    struct ac_port_frame_t* const frame = _ac_intr_handler(vect, prev);
     mg_critical_section_enter();
 
-    if (frame != next_frame) {
+    if (prev == frame) {
         ac_gpic_done(&g_pic);
     }
 
-    return next_frame;
+    return frame;
 }
 
 //
-// N.B. When returned frame is the same as parameter it means that called 
-// actors are completed synchronously so interrupt should be marked as
-// completed.
+// N.B. Synchronous syscalls return the same frame as input, otherwise it
+// is assumed that the call is asynchronous and the current actor is
+// completed. Actors pending after the completion are tail-chained right away
+// instead of taking another software interrupt.
 //
 
-struct ac_port_frame_t* ac_port_msi_handler(struct ac_port_frame_t* prev) {
-    const unsigned vect = ac_gpic_start(&g_pic);
+struct ac_port_frame_t* ac_port_trap_handler(
+    struct ac_port_frame_t* frame,
+    uint32_t mcause
+) {
     mg_critical_section_leave();
-    struct ac_port_frame_t* const frame = _ac_intr_handler(vect, prev);
+    const uint32_t syscall = frame->r[REG_A0];
+    struct ac_port_frame_t* const next_frame = (mcause == MCAUSE_ENVCALL) ?
+        (frame->pc += sizeof(uint32_t)), _ac_svc_handler(syscall, frame):
+        ac_actor_exception();
     mg_critical_section_enter();
 
-    if (prev == frame) {
-        ac_gpic_done(&g_pic);
+    if (frame == next_frame) {
+        return next_frame;
     }
 
-    return frame;
+    ac_gpic_done(&g_pic);
+    return ac_gpic_unmasked(&g_pic) ? 
+        ac_port_msi_handler(next_frame) : next_frame;
 }
 
@@ -21,7 +21,13 @@ NMI_Handler:
 .section .text
 .align 4
 startup:
+.ifdef AC_PORT_CLIC
 	la      t0, ac_port_intr_entry
+	ori     t0, t0, 3               /* CLIC mode */
+.else
+	la      t0, ac_port_vectors
+	ori     t0, t0, 1               /* vectored mode */
+.endif
 	csrw    mtvec, t0
 	la      sp, _estack
 	csrc    mstatus, MSTATUS_MIE
@@ -39,8 +45,12 @@ startup:
 .global mie_init
 mie_init:
 	csrc    mstatus, MSTATUS_MIE
+.ifdef AC_PORT_CLIC
+    j       clic_setup              /* mie is not used in CLIC mode */
+.else
     csrs    mie, MIE_MSIE           /* enable machine sw interrupts */
     li      t0, MIE_MTIE
     csrs    mie, t0                 /* enable machine timer interrupts */
     ret
+.endif
 
@@ -45,6 +45,10 @@ void* ac_svc_handler(uint32_t arg, void* frame) {
     return _ac_svc_handler(arg, frame);
 }
 
+void* ac_svc_handoff(void* frame) {
+    return _ac_svc_handoff(frame);
+}
+
 void* ac_trap_handler(uint32_t id) {
     return ac_actor_exception();
 }
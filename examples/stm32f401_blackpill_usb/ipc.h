@@ -16,6 +16,7 @@ enum {
     CHAN_USB_SERVER_OUT,
     CHAN_APP_POOL,
     CHAN_LED_SERVER_IN,
+    CHAN_USB_IRQ,
     CHAN_NUM,
 };
 
@@ -24,14 +25,13 @@ enum {
     LED_MSG_SZ = 32,
 };
 
-enum usb_opcode_t {
-    USB_INTERRUPT,
-    USB_TX_REQUEST,
+enum {
+    USB_TX_SLOT,
+    MSG_SLOTS_NUM,
 };
 
 struct usb_msg_header_t {
     struct ac_message_t base;
-    enum usb_opcode_t opcode;
     uint8_t payload_len;
 };
 
@@ -9,9 +9,12 @@
 #include "stm32f4xx.h"
 
 #define MG_NVIC_PRIO_BITS 4
+#define AC_MSG_SLOTS 1
 #include "actinium.h"
 #include "ipc.h"
 
+_Static_assert(AC_MSG_SLOTS == MSG_SLOTS_NUM, "wrong number of msg slots");
+
 #if __NVIC_PRIO_BITS != MG_NVIC_PRIO_BITS
 #error NVIC priority bits do not match in the kernel and chip header.
 #endif
@@ -34,13 +37,8 @@ void SysTick_Handler(void) {
 }
 
 void OTG_FS_IRQHandler(void) {
-    struct usb_msg_t* msg = mg_message_alloc(&(g_chan[CHAN_USB_POOL].base));
-
-    if (msg) {
-        msg->header.opcode = USB_INTERRUPT;
-        USB_OTG_FS->GAHBCFG &= ~1u;
-        mg_queue_push(&(g_chan[CHAN_USB_SERVER_IN].base.queue), (void*) msg);
-    }
+    USB_OTG_FS->GAHBCFG &= ~1u;
+    ac_channel_notify(&g_chan[CHAN_USB_IRQ], 1);
 }
 
 void __assert_func(
@@ -60,6 +58,10 @@ void* ac_svc_handler(uint32_t arg, void* frame) {
     return _ac_svc_handler(arg, frame);
 }
 
+void* ac_svc_handoff(void* frame) {
+    return _ac_svc_handoff(frame);
+}
+
 void* ac_trap_handler(uint32_t id) {
     return ac_actor_exception();
 }
@@ -170,6 +172,7 @@ int main(void) {
     static alignas(sizeof(struct led_msg_t)) struct led_msg_t g_led_msgs[1];
     ac_channel_init_ex(&g_chan[CHAN_APP_POOL], sizeof(g_led_msgs), g_led_msgs, sizeof(g_led_msgs[0]));
     ac_channel_init(&g_chan[CHAN_LED_SERVER_IN]);
+    ac_channel_init_event(&g_chan[CHAN_USB_IRQ]);
 
     static struct ac_actor_t g_usb_server;
     ac_actor_init(&g_usb_server, 0, descr_by_id(0));
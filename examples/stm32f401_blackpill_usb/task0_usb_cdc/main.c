@@ -2,20 +2,20 @@
  * @file   main.c
  * @brief  USB CDC server.
  *  
- * The server uses a single input channel with two types of messages:
- * - interrupt message
- * - transfer request message
+ * The server waits for messages from two input channels at once:
+ * - interrupt channel
+ * - transfer request channel
  * 
  * Interrupt messages are sent by the kernel for each hardware interrupt from
  * the device. Transfer request messages are sent by clients and contain a 
- * payload to be sent over USB.
+ * payload to be sent over USB. The message type is defined by the channel
+ * it was received from.
  * If the device is busy when the tx request message arrives then the message
  * is preserved in the special private channel to be sent later.
  * 
- * In the current design an actor may own just a single message at any time.
- * So, the payload has to be copied into local buffer before sending as
- * there may be multiple accesses to the buffer in case when the payload does 
- * not fit into a single USB packet.
+ * The message being sent is parked in the message slot, so the payload is
+ * sent directly from the message while the server receives new ones. The
+ * message is freed when the transfer is completed.
  */
 
 #include <stddef.h>
@@ -38,14 +38,9 @@ static bool g_tx_complete = false;
 static size_t g_rx_len = 0;
 static size_t g_tx_msg_pending_count = 0;
 static uint8_t g_rx_buffer[2048];
-static uint8_t g_tx_buffer[2048];
 
 #define MSG_PAYLOAD_SZ sizeof(((struct usb_msg_t*)0)->payload)
 
-_Static_assert(
-    sizeof(g_tx_buffer) >= MSG_PAYLOAD_SZ,
-    "tx buffer must be larger than message payload");
-
 void Error_Handler(void) {
     for (;;);
 }
@@ -81,7 +76,7 @@ void* memmove(void *dest, const void *src, size_t n) {
 }
 
 static int8_t CDC_Init_FS(void) {
-    USBD_CDC_SetTxBuffer(&g_cdc_device, g_tx_buffer, 0);
+    USBD_CDC_SetTxBuffer(&g_cdc_device, NULL, 0);
     USBD_CDC_SetRxBuffer(&g_cdc_device, g_rx_buffer);
     return USBD_OK;
 }
@@ -138,13 +133,13 @@ static inline void USB_Init(void)
     }
 }
 
-static inline void Tx_Start(const struct usb_msg_t* msg) {
+static inline void Tx_Start(struct usb_msg_t* msg) {
     const size_t len = MIN(msg->header.payload_len, MSG_PAYLOAD_SZ);
-    memmove(g_tx_buffer, msg->payload, len);
-    CDC_Transmit_FS(g_tx_buffer, len);
+    CDC_Transmit_FS(msg->payload, len);
+    ac_slot_swap(USB_TX_SLOT);
 }
 
-static inline void Tx_Msg_Process(const struct usb_msg_t* msg) {
+static inline void Tx_Msg_Process(struct usb_msg_t* msg) {
     if (++g_tx_msg_pending_count == 1) {
         Tx_Start(msg);
     } else {
@@ -155,6 +150,7 @@ static inline void Tx_Msg_Process(const struct usb_msg_t* msg) {
 static inline void Tx_Completion_Check(void) {
     if (g_tx_complete) {
         g_tx_complete = false;
+        ac_slot_free(USB_TX_SLOT);
 
         if (--g_tx_msg_pending_count) {
             struct usb_msg_t* msg = ac_try_pop(CHAN_USB_SERVER_PRIV);
@@ -165,8 +161,10 @@ static inline void Tx_Completion_Check(void) {
     }
 }
 
-static inline void Rx_Check(struct usb_msg_t* msg) {
-    if (g_rx_len) {
+static inline void Rx_Check(void) {
+    struct usb_msg_t* msg = g_rx_len ? ac_try_pop(CHAN_USB_POOL) : NULL;
+
+    if (msg) {
         const size_t len = MIN(g_rx_len, sizeof(msg->payload));
         msg->header.payload_len = len;
         memmove(msg->payload, g_rx_buffer, len);
@@ -175,31 +173,28 @@ static inline void Rx_Check(struct usb_msg_t* msg) {
     }
 }
 
-static inline void Incoming_Msg_Process(struct usb_msg_t* msg) {
+static inline void Irq_Process(void) {
     extern PCD_HandleTypeDef hpcd_USB_OTG_FS;
-
-    switch (msg->header.opcode) {
-    case USB_INTERRUPT:        
-        HAL_PCD_IRQHandler(&hpcd_USB_OTG_FS);
-        USB_EnableGlobalInt(USB_OTG_FS);
-        Rx_Check(msg);
-        Tx_Completion_Check();
-        break;
-    case USB_TX_REQUEST:
-        Tx_Msg_Process(msg);
-        break;
-    default:
-        break;
-    }
+    (void) ac_events_poll(CHAN_USB_IRQ);
+    HAL_PCD_IRQHandler(&hpcd_USB_OTG_FS);
+    USB_EnableGlobalInt(USB_OTG_FS);
+    Rx_Check();
+    Tx_Completion_Check();
 }
 
 uint32_t main(struct usb_msg_t* msg) {
-    if (msg == NULL) {
+    static bool s_started = false;
+
+    if (!s_started) {
+        s_started = true;
         USB_Init();
+    } else if (msg == NULL) {
+        Irq_Process(); /* Event channel is selected with no message. */
     } else {
-        Incoming_Msg_Process(msg);
+        Tx_Msg_Process(msg);
     }
     
-    return ac_subscribe_to(CHAN_USB_SERVER_IN);
+    return ac_select(CHAN_USB_SERVER_IN, 
+        1 | (1 << (CHAN_USB_IRQ - CHAN_USB_SERVER_IN)));
 }
 
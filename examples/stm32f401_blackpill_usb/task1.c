@@ -22,7 +22,6 @@ static inline void set_led(uint8_t state) {
 uint32_t main(struct usb_msg_t* recv_msg) {
     if (recv_msg) {
         const uint8_t control = recv_msg->payload[0];
-        recv_msg->header.opcode = USB_TX_REQUEST;
         ac_push(CHAN_USB_SERVER_IN); /* send echo */
 
         if ((control == '0') || (control == '1')) {
@@ -86,8 +86,8 @@ int main(void) {
     ac_context_stack_set(1, sizeof(stack1), stack1);
 
     static alignas(sizeof(struct demo_msg_t)) struct demo_msg_t g_storage[2];
-    ac_channel_init_ex(&g_chan[0], sizeof(g_storage), g_storage, sizeof(g_storage[0]), 1);
-    ac_channel_init(&g_chan[1], 1);
+    ac_channel_init_ex(&g_chan[0], sizeof(g_storage), g_storage, sizeof(g_storage[0]));
+    ac_channel_init(&g_chan[1]);
     
     static struct ac_actor_t g_receiver;
     struct ac_actor_descr_t receiver_descr = { (uintptr_t) actor1, 32, 0, 0 };
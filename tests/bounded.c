@@ -0,0 +1,154 @@
+/*
+ *  @file   bounded.c
+ *  @brief  Bounded channel: pushes over the limit are rejected.
+ */
+
+#include <stdio.h>
+#include <stdalign.h>
+#include <setjmp.h>
+#include <assert.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context; 
+
+enum {
+    CHAN_POOL,
+    CHAN_CMD,
+    CHAN_REPLY,
+    CHAN_WORK,
+};
+
+static struct ac_channel_t g_chan[4];
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor, 
+    unsigned int handle,
+    bool is_write
+) {
+    const size_t max_id = sizeof(g_chan) / sizeof(g_chan[0]);
+    return (handle < max_id) ? &g_chan[handle] : 0;
+}
+
+struct demo_msg_t {
+    struct ac_message_t header;
+    uint32_t foo[9];
+};
+
+_Static_assert(sizeof(struct demo_msg_t) == 64, "wrong msg size");
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+enum {
+    MSG_NUM = 4,
+    LIMIT = 2,
+    WORKERS = 2,
+};
+
+static unsigned int g_received;
+static bool g_call_rejected;
+static unsigned int g_worked[WORKERS];
+
+/* Workers outrank the client, so both of them wait when it pushes. */
+static uint32_t worker(unsigned int i, void* arg) {
+    if (arg) {
+        ++g_worked[i];
+    }
+
+    return ac_subscribe_to(CHAN_WORK);
+}
+
+uint32_t worker0(void* arg) { return worker(0, arg); }
+uint32_t worker1(void* arg) { return worker(1, arg); }
+
+uint32_t server(void* arg) {
+    const struct demo_msg_t* const msg = arg;
+
+    if (msg) {
+        assert(msg->foo[0] == g_received);
+        ++g_received;
+    }
+
+    return ac_subscribe_to(CHAN_CMD);
+}
+
+/* Client outranks the server so the channel is filled up first. */
+uint32_t client(void* arg) {
+    static bool s_sent = false;
+
+    if (s_sent) {
+        /* Rejected call completes with no reply. */
+        assert(arg == 0);
+        g_call_rejected = true;
+        return ac_sleep_for(1);
+    }
+
+    for (uint32_t i = 0; i < WORKERS; ++i) {
+        assert(ac_try_pop(CHAN_POOL) != 0);
+        assert(ac_push(CHAN_WORK) == 0);
+    }
+
+    for (uint32_t i = 0; i < LIMIT; ++i) {
+        struct demo_msg_t* const msg = ac_try_pop(CHAN_POOL);
+        assert(msg != 0);
+        msg->foo[0] = i;
+        assert(ac_push(CHAN_CMD) == 0);
+    }
+
+    /* Rejected message remains owned. */
+    struct demo_msg_t* const msg = ac_try_pop(CHAN_POOL);
+    assert(msg != 0);
+    assert(ac_push(CHAN_CMD) == msg);
+    msg->foo[0] = LIMIT;
+    assert(g_chan[CHAN_CMD].depth == LIMIT);
+
+    s_sent = true;
+    return ac_push_and_subscribe(CHAN_CMD, CHAN_REPLY);
+}
+
+int main(void) {
+    ac_context_init();
+    static uint8_t stack0[512];
+    static uint8_t stack1[512];
+    static uint8_t stack2[512];
+    ac_context_stack_set(0, sizeof(stack0), stack0);
+    ac_context_stack_set(1, sizeof(stack1), stack1);
+    ac_context_stack_set(2, sizeof(stack2), stack2);
+
+    static alignas(sizeof(struct demo_msg_t)) struct demo_msg_t g_pool[MSG_NUM + WORKERS];
+    ac_channel_init_ex(&g_chan[CHAN_POOL], sizeof(g_pool), g_pool, sizeof(g_pool[0]));
+    ac_channel_init(&g_chan[CHAN_CMD]);
+    ac_channel_init(&g_chan[CHAN_REPLY]);
+    ac_channel_limit_set(&g_chan[CHAN_CMD], LIMIT);
+    ac_channel_init(&g_chan[CHAN_WORK]);
+    ac_channel_limit_set(&g_chan[CHAN_WORK], LIMIT);
+
+    static struct ac_actor_t g_server;
+    struct ac_actor_descr_t server_descr = { (uintptr_t) server, 32, 0, 0 };
+    ac_actor_init(&g_server, 0, &server_descr);
+
+    static struct ac_actor_t g_client;
+    struct ac_actor_descr_t client_descr = { (uintptr_t) client, 32, 0, 0 };
+    ac_actor_init(&g_client, 1, &client_descr);
+
+    static struct ac_actor_t g_workers[WORKERS];
+    uint32_t (* const workers[WORKERS])(void*) = { worker0, worker1 };
+
+    for (unsigned int i = 0; i < WORKERS; ++i) {
+        struct ac_actor_descr_t worker_descr = { (uintptr_t) workers[i], 32, 0, 0 };
+        ac_actor_init(&g_workers[i], 2, &worker_descr);
+    }
+
+    ac_port_swi_handler();
+    assert(g_received == LIMIT);
+    assert(g_call_rejected);
+    assert(g_chan[CHAN_CMD].depth == 0);
+
+    /* Each waiting worker gets its own message, none stays queued. */
+    assert(g_worked[0] == 1 && g_worked[1] == 1);
+    assert(g_chan[CHAN_WORK].depth == 0);
+    return 0;
+}
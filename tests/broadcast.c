@@ -0,0 +1,136 @@
+/*
+ *  @file   broadcast.c
+ *  @brief  Fan-out of shared messages to several readers.
+ */
+
+#include <stdio.h>
+#include <stdalign.h>
+#include <setjmp.h>
+#include <assert.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context; 
+
+enum {
+    CHAN_SAMPLE,
+    CHAN_SINK,
+};
+
+static struct ac_channel_t g_chan[2];
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor, 
+    unsigned int handle,
+    bool is_write
+) {
+    const size_t max_id = sizeof(g_chan) / sizeof(g_chan[0]);
+    return (handle < max_id) ? &g_chan[handle] : 0;
+}
+
+struct demo_msg_t {
+    struct ac_message_t header;
+    uint32_t foo[9];
+};
+
+_Static_assert(sizeof(struct demo_msg_t) == 64, "wrong msg size");
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+enum {
+    SAMPLES = 3,
+};
+
+static struct demo_msg_t* g_sent[SAMPLES];
+static unsigned int g_fast_count;
+static unsigned int g_slow_count;
+
+/* Fast reader outranks the producer so it sees every sample. */
+uint32_t fast_reader(void* arg) {
+    const struct demo_msg_t* const msg = arg;
+
+    if (msg) {
+        assert(msg == g_sent[g_fast_count]);
+        assert(msg->header.chan == CHAN_SAMPLE);
+        assert(msg->foo[0] == ++g_fast_count);
+    }
+
+    return ac_subscribe_to(CHAN_SAMPLE);
+}
+
+/* Slow reader sees the first sample and then only the latest one. */
+uint32_t slow_reader(void* arg) {
+    const struct demo_msg_t* const msg = arg;
+
+    if (msg) {
+        const uint32_t expected[] = { 1, SAMPLES };
+        assert(msg == g_sent[expected[g_slow_count] - 1]);
+        assert(msg->foo[0] == expected[g_slow_count]);
+        ++g_slow_count;
+    }
+
+    return ac_subscribe_to(CHAN_SAMPLE);
+}
+
+uint32_t producer(void* arg) {
+    AC_ACTOR_START;
+
+    for (uint32_t i = 0; i < SAMPLES; ++i) {
+        struct demo_msg_t* const msg = ac_try_pop(CHAN_SAMPLE);
+        assert(msg != 0);
+        msg->foo[0] = i + 1;
+        g_sent[i] = msg;
+        ac_push(CHAN_SAMPLE);
+    }
+
+    AC_AWAIT(ac_sleep_for(1));
+    AC_ACTOR_END;
+}
+
+int main(void) {
+    ac_context_init();
+    static uint8_t stack0[512];
+    static uint8_t stack1[512];
+    static uint8_t stack2[512];
+    ac_context_stack_set(0, sizeof(stack0), stack0);
+    ac_context_stack_set(1, sizeof(stack1), stack1);
+    ac_context_stack_set(2, sizeof(stack2), stack2);
+
+    static alignas(sizeof(struct demo_msg_t)) struct demo_msg_t g_pool[SAMPLES];
+    static uint8_t g_refs[SAMPLES];
+    ac_channel_init_broadcast(&g_chan[CHAN_SAMPLE], sizeof(g_pool), g_pool, sizeof(g_pool[0]), g_refs);
+    ac_channel_init(&g_chan[CHAN_SINK]);
+
+    static struct ac_actor_t g_fast;
+    struct ac_actor_descr_t fast_descr = { (uintptr_t) fast_reader, 32, 0, 0 };
+    ac_actor_init(&g_fast, 2, &fast_descr);
+
+    static struct ac_actor_t g_slow;
+    struct ac_actor_descr_t slow_descr = { (uintptr_t) slow_reader, 32, 0, 0 };
+    ac_actor_init(&g_slow, 0, &slow_descr);
+
+    static struct ac_reader_t g_readers[2];
+    ac_channel_reader_add(&g_chan[CHAN_SAMPLE], &g_readers[0], &g_fast);
+    ac_channel_reader_add(&g_chan[CHAN_SAMPLE], &g_readers[1], &g_slow);
+
+    ac_port_swi_handler(); /* readers are waiting for the first sample */
+
+    static struct ac_actor_t g_producer;
+    struct ac_actor_descr_t producer_descr = { (uintptr_t) producer, 32, 0, 0 };
+    ac_actor_init(&g_producer, 1, &producer_descr);
+    ac_port_swi_handler();
+
+    assert(g_fast_count == SAMPLES);
+    assert(g_slow_count == 2);
+
+    /* The dropped sample and the ones read by both readers are returned. */
+    for (unsigned int i = 0; i < SAMPLES; ++i) {
+        assert(g_refs[i] == 0);
+        assert(mg_queue_pop(&g_chan[CHAN_SAMPLE].base.queue, 0) != 0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ *  @file   events.c
+ *  @brief  Event channel: notifications are coalesced without messages.
+ */
+
+#include <stdio.h>
+#include <stdalign.h>
+#include <setjmp.h>
+#include <assert.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context; 
+
+enum {
+    CHAN_POOL,
+    CHAN_CMD,
+    CHAN_EVENTS,
+};
+
+static struct ac_channel_t g_chan[3];
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor, 
+    unsigned int handle,
+    bool is_write
+) {
+    const size_t max_id = sizeof(g_chan) / sizeof(g_chan[0]);
+    return (handle < max_id) ? &g_chan[handle] : 0;
+}
+
+struct demo_msg_t {
+    struct ac_message_t header;
+    uint32_t foo[9];
+};
+
+_Static_assert(sizeof(struct demo_msg_t) == 64, "wrong msg size");
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+enum {
+    MSG_NUM = 1,
+};
+
+static struct ac_actor_t g_waiter;
+static unsigned int g_state;
+
+uint32_t waiter(void* arg) {
+    static struct demo_msg_t* s_msg;
+
+    switch (g_state++) {
+    case 0:
+        s_msg = ac_try_pop(CHAN_POOL);
+        assert(s_msg != 0);
+        return ac_subscribe_to(CHAN_EVENTS);
+    case 1:
+        /* Bits set before the wait are coalesced, the message is kept. */
+        assert((uintptr_t) arg == 3);
+        assert(g_waiter.base.mailbox == &s_msg->header.header);
+        return ac_subscribe_to(CHAN_EVENTS);
+    case 2:
+        assert((uintptr_t) arg == 8);
+        s_msg->foo[0] = 1;
+        return ac_select(CHAN_CMD, 3);
+    case 3:
+        /* Selected event channel is polled. */
+        assert(arg == 0);
+        assert(ac_events_poll(CHAN_EVENTS) == 48);
+        assert(ac_events_poll(CHAN_EVENTS) == 0);
+        return ac_subscribe_to(CHAN_EVENTS);
+    default:
+        assert(0);
+        return 0;
+    }
+}
+
+/* Notifier outranks the waiter so it runs first. */
+uint32_t notifier(void* arg) {
+    ac_notify(CHAN_EVENTS, 1);
+    ac_notify(CHAN_EVENTS, 2);
+    return ac_subscribe_to(CHAN_CMD);
+}
+
+int main(void) {
+    ac_context_init();
+    static uint8_t stack0[512];
+    static uint8_t stack1[512];
+    ac_context_stack_set(0, sizeof(stack0), stack0);
+    ac_context_stack_set(1, sizeof(stack1), stack1);
+
+    static alignas(sizeof(struct demo_msg_t)) struct demo_msg_t g_pool[MSG_NUM];
+    ac_channel_init_ex(&g_chan[CHAN_POOL], sizeof(g_pool), g_pool, sizeof(g_pool[0]));
+    ac_channel_init(&g_chan[CHAN_CMD]);
+    ac_channel_init_event(&g_chan[CHAN_EVENTS]);
+
+    struct ac_actor_descr_t waiter_descr = { (uintptr_t) waiter, 32, 0, 0 };
+    ac_actor_init(&g_waiter, 0, &waiter_descr);
+
+    static struct ac_actor_t g_notifier;
+    struct ac_actor_descr_t notifier_descr = { (uintptr_t) notifier, 32, 0, 0 };
+    ac_actor_init(&g_notifier, 1, &notifier_descr);
+
+    ac_port_swi_handler();
+    assert(g_state == 2);
+
+    /* Interrupt handler notifies the waiting actor directly. */
+    ac_channel_notify(&g_chan[CHAN_EVENTS], 8);
+    ac_port_swi_handler();
+    assert(g_state == 3);
+
+    ac_channel_notify(&g_chan[CHAN_EVENTS], 16);
+    ac_channel_notify(&g_chan[CHAN_EVENTS], 32);
+    ac_port_swi_handler();
+    assert(g_state == 4);
+    assert(g_chan[CHAN_EVENTS].waiters == &g_waiter);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ *  @file   fpu.c
+ *  @brief  FPU access is granted only to the actors with the FPU flag.
+ *          FP state of the preempted actor is saved before the switch only.
+ */
+
+#define AC_PORT_FPU 1
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <assert.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context;
+
+static struct ac_channel_t g_events;
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor,
+    unsigned int handle,
+    bool is_write
+) {
+    return (handle == 0) ? &g_events : 0;
+}
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+static unsigned int g_dsp_runs;
+static unsigned int g_worker_runs;
+
+/* Worker outranks the dsp actor and preempts it on each notification. */
+uint32_t worker(void* arg) {
+    assert(!g_fpu_granted);
+
+    if (arg) {
+        ++g_worker_runs;
+    }
+
+    return ac_subscribe_to(0);
+}
+
+uint32_t dsp(void* arg) {
+    assert(g_fpu_granted);
+    const unsigned int saves = g_fp_lazy_saves;
+
+    /* Synchronous syscall which switches nothing doesn't save FP state. */
+    ac_events_poll(0);
+    assert(g_fp_lazy_saves == saves);
+
+    ac_notify(0, 1);
+    assert(g_worker_runs == g_dsp_runs + 1);
+    assert(g_fpu_granted);
+    assert(g_fp_lazy_saves > saves);
+    ++g_dsp_runs;
+    return ac_sleep_for(1);
+}
+
+int main(void) {
+    ac_context_init();
+    static uint8_t stack1[512];
+    static uint8_t stack2[512];
+    ac_context_stack_set(1, sizeof(stack1), stack1);
+    ac_context_stack_set(2, sizeof(stack2), stack2);
+    ac_channel_init_event(&g_events);
+
+    static uint8_t sram[64];
+    static struct ac_actor_t g_worker;
+    static struct ac_actor_t g_dsp;
+    struct ac_actor_descr_t descr = { (uintptr_t) worker, 32, (uintptr_t) sram, 64 };
+    struct ac_actor_descr_t dsp_descr = { (uintptr_t) dsp, 32, (uintptr_t) sram, 64, true };
+
+    /* Integer-only actor doesn't change the grant of the idle-loop. */
+    ac_actor_init(&g_worker, 2, &descr);
+    ac_port_swi_handler();
+    assert(g_fpu_grants == 0);
+
+    /* The grant is changed on entry and exit of the dsp actor only. */
+    ac_actor_init(&g_dsp, 1, &dsp_descr);
+    ac_port_swi_handler();
+    assert(g_dsp_runs == 1 && !g_fpu_granted);
+    assert(g_fpu_grants == 4);
+
+    ac_context_tick();
+    ac_port_swi_handler();
+    assert(g_dsp_runs == 2 && !g_fpu_granted);
+    assert(g_fpu_grants == 8);
+    return 0;
+}
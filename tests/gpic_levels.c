@@ -0,0 +1,88 @@
+/*
+ *  @file   gpic_levels.c
+ *  @brief  Software PIC with more than 32 vectors keeps the priority order.
+ */
+
+#define MG_PRIO_MAX 96
+#define AC_GPIC_PRIO_NUM 96
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <assert.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context;
+
+/* Vectors of the waiting actors are taken from different bitmap words. */
+enum {
+    VECT_LOW = 31,
+    VECT_MID = 33,
+    VECT_HIGH = 64,
+    VECT_SENDER = 90,
+};
+
+static struct ac_channel_t g_events[3];
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor,
+    unsigned int handle,
+    bool is_write
+) {
+    return (handle < 3) ? &g_events[handle] : 0;
+}
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+static unsigned int g_order[3];
+static unsigned int g_runs;
+
+static uint32_t waiter(unsigned int id, void* arg) {
+    if (arg) {
+        g_order[g_runs++] = id;
+    }
+
+    return ac_subscribe_to(id);
+}
+
+uint32_t low(void* arg) { return waiter(0, arg); }
+uint32_t mid(void* arg) { return waiter(1, arg); }
+uint32_t high(void* arg) { return waiter(2, arg); }
+
+/* Notifications are masked until the sender completes. */
+uint32_t sender(void* arg) {
+    ac_notify(0, 1);
+    ac_notify(1, 1);
+    ac_notify(2, 1);
+    assert(g_runs == 0);
+    return ac_sleep_for(100);
+}
+
+int main(void) {
+    static uint8_t stacks[4][256];
+    static uint8_t sram[64];
+    static struct ac_actor_t g_actors[4];
+    const unsigned int vects[4] = { VECT_LOW, VECT_MID, VECT_HIGH, VECT_SENDER };
+    uint32_t (* const funcs[4])(void*) = { low, mid, high, sender };
+
+    ac_context_init();
+
+    for (unsigned int i = 0; i < 3; ++i) {
+        ac_channel_init_event(&g_events[i]);
+    }
+
+    for (unsigned int i = 0; i < 4; ++i) {
+        struct ac_actor_descr_t descr = { (uintptr_t) funcs[i], 32, (uintptr_t) sram, 64 };
+        ac_context_stack_set(vects[i], sizeof(stacks[i]), stacks[i]);
+        ac_actor_init(&g_actors[i], vects[i], &descr);
+        ac_port_swi_handler();
+    }
+
+    assert(g_runs == 3);
+    assert(g_order[0] == 2 && g_order[1] == 1 && g_order[2] == 0);
+    assert(g_pic.mask == 0);
+    return 0;
+}
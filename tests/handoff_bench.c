@@ -0,0 +1,118 @@
+/*
+ *  @file   handoff_bench.c
+ *  @brief  Ping-pong between actors with and without direct handoff.
+ */
+
+#include <stdio.h>
+#include <stdalign.h>
+#include <setjmp.h>
+#include <assert.h>
+#include <time.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context;
+
+enum {
+    CHAN_POOL,
+    CHAN_REQUEST,
+    CHAN_IDLE,
+};
+
+enum {
+    ROUND_TRIPS = 100000,
+};
+
+static struct ac_channel_t g_chan[3];
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor,
+    unsigned int handle,
+    bool is_write
+) {
+    const size_t max_id = sizeof(g_chan) / sizeof(g_chan[0]);
+    return (handle < max_id) ? &g_chan[handle] : 0;
+}
+
+struct demo_msg_t {
+    struct ac_message_t header;
+    uint32_t foo[9];
+};
+
+_Static_assert(sizeof(struct demo_msg_t) == 64, "wrong msg size");
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+static unsigned int g_served;
+
+uint32_t server(void* arg) {
+    if (arg) {
+        ++g_served;
+        ac_free();
+    }
+
+    return ac_subscribe_to(CHAN_REQUEST);
+}
+
+/*
+ * Each round trip is a synchronous push from the low priority client which
+ * activates the server. Returns the number of interrupt entries.
+ */
+static unsigned int bench(bool handoff) {
+    const unsigned int entries = g_swi_entries;
+    const unsigned int served = g_served;
+    const clock_t start = clock();
+    g_handoff = handoff;
+
+    for (unsigned int i = 0; i < ROUND_TRIPS; ++i) {
+        void* const msg = ac_try_pop(CHAN_POOL);
+        assert(msg != 0);
+        (void) msg;
+        ac_push(CHAN_REQUEST);
+    }
+
+    const double ns = (double) (clock() - start) * 1e9 / CLOCKS_PER_SEC;
+    const unsigned int result = g_swi_entries - entries;
+    assert(g_served - served == ROUND_TRIPS);
+    printf("handoff %s: %.1f ns per round trip, %.2f interrupts per round trip\n",
+        handoff ? "on" : "off", ns / ROUND_TRIPS, (double) result / ROUND_TRIPS);
+    return result;
+}
+
+static unsigned int g_entries[2];
+
+uint32_t client(void* arg) {
+    g_entries[0] = bench(false);
+    g_entries[1] = bench(true);
+    return ac_subscribe_to(CHAN_IDLE);
+}
+
+int main(void) {
+    ac_context_init();
+    static uint8_t stack0[512];
+    static uint8_t stack1[512];
+    ac_context_stack_set(0, sizeof(stack0), stack0);
+    ac_context_stack_set(1, sizeof(stack1), stack1);
+
+    static alignas(sizeof(struct demo_msg_t)) struct demo_msg_t g_pool[1];
+    ac_channel_init_ex(&g_chan[CHAN_POOL], sizeof(g_pool), g_pool, sizeof(g_pool[0]));
+    ac_channel_init(&g_chan[CHAN_REQUEST]);
+    ac_channel_init(&g_chan[CHAN_IDLE]);
+
+    static struct ac_actor_t g_client;
+    struct ac_actor_descr_t client_descr = { (uintptr_t) client, 32, 0, 0 };
+    ac_actor_init(&g_client, 0, &client_descr);
+
+    static struct ac_actor_t g_server;
+    struct ac_actor_descr_t server_descr = { (uintptr_t) server, 32, 0, 0 };
+    ac_actor_init(&g_server, 1, &server_descr);
+
+    ac_port_swi_handler();
+    assert(g_served == 2 * ROUND_TRIPS);
+    assert(g_entries[0] == ROUND_TRIPS);
+    assert(g_entries[1] == 0);
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ *  @file   mpu_diff.c
+ *  @brief  Only the regions which differ are written on actor switch.
+ */
+
+#include <stdio.h>
+#include <stdalign.h>
+#include <setjmp.h>
+#include <assert.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context;
+
+static struct ac_channel_t g_pool;
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor,
+    unsigned int handle,
+    bool is_write
+) {
+    return (handle == 0) ? &g_pool : 0;
+}
+
+struct demo_msg_t {
+    struct ac_message_t header;
+    uint32_t foo[9];
+};
+
+_Static_assert(sizeof(struct demo_msg_t) == 64, "wrong msg size");
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+static unsigned int g_runs;
+
+uint32_t worker(void* arg) {
+    ++g_runs;
+    return ac_sleep_for(1);
+}
+
+/* Message calls change the message region only. */
+uint32_t owner(void* arg) {
+    unsigned int writes = g_region_writes;
+    struct demo_msg_t* const msg = ac_try_pop(0);
+    assert(msg != 0);
+    assert(g_region_writes - writes == 1);
+
+    writes = g_region_writes;
+    ac_free();
+    assert(g_region_writes - writes == 1);
+    ++g_runs;
+    return ac_sleep_for(1);
+}
+
+/* Returns the number of region writes for a single burst. */
+static unsigned int burst(void) {
+    const unsigned int writes = g_region_writes;
+    ac_context_tick();
+    ac_port_swi_handler();
+    return g_region_writes - writes;
+}
+
+int main(void) {
+    ac_context_init();
+    static uint8_t stack1[512];
+    static uint8_t stack2[512];
+    ac_context_stack_set(1, sizeof(stack1), stack1);
+    ac_context_stack_set(2, sizeof(stack2), stack2);
+
+    static alignas(sizeof(struct demo_msg_t)) struct demo_msg_t g_msgs[1];
+    ac_channel_init_ex(&g_pool, sizeof(g_msgs), g_msgs, sizeof(g_msgs[0]));
+
+    static uint8_t sram[64];
+    static struct ac_actor_t g_worker[2];
+    struct ac_actor_descr_t descr = { (uintptr_t) worker, 32, (uintptr_t) sram, 64 };
+    ac_actor_init(&g_worker[0], 1, &descr);
+    ac_actor_init(&g_worker[1], 1, &descr);
+    ac_port_swi_handler();
+    assert(g_runs == 2);
+
+    /*
+     * Each switch between idle and an actor writes its code, data and stack
+     * regions, the rest are disabled in both and are skipped.
+     */
+    const unsigned int writes = burst();
+    printf("mpu diff: %u of %u region writes per burst\n", writes, 4 * AC_REGIONS_NUM);
+    assert(writes == 4 * 3);
+
+    const unsigned int runs = g_runs;
+    static struct ac_actor_t g_owner;
+    struct ac_actor_descr_t owner_descr = { (uintptr_t) owner, 32, (uintptr_t) sram, 64 };
+    ac_actor_init(&g_owner, 2, &owner_descr);
+    ac_port_swi_handler();
+    assert(g_runs == runs + 1);
+    return 0;
+}
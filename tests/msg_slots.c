@@ -0,0 +1,118 @@
+/*
+ *  @file   msg_slots.c
+ *  @brief  Holding several messages at once using message slots.
+ */
+
+#include <stdio.h>
+#include <stdalign.h>
+#include <setjmp.h>
+#include <assert.h>
+#define AC_MSG_SLOTS 2
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context;
+
+enum {
+    CHAN_POOL,
+    CHAN_REQUEST,
+};
+
+static struct ac_channel_t g_chan[2];
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor,
+    unsigned int handle,
+    bool is_write
+) {
+    const size_t max_id = sizeof(g_chan) / sizeof(g_chan[0]);
+    return (handle < max_id) ? &g_chan[handle] : 0;
+}
+
+struct demo_msg_t {
+    struct ac_message_t header;
+    uint32_t foo[9];
+};
+
+_Static_assert(sizeof(struct demo_msg_t) == 64, "wrong msg size");
+
+static unsigned int g_errors;
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    ++g_errors;
+}
+
+static struct demo_msg_t* g_held;
+
+uint32_t server(void* arg) {
+    struct demo_msg_t* msg = arg;
+    AC_ACTOR_START;
+
+    /* First request is parked, second one is received while holding it. */
+    AC_AWAIT(ac_subscribe_to(CHAN_REQUEST));
+    assert(msg != 0 && msg->foo[0] == 1);
+    g_held = msg;
+    msg = ac_slot_swap(0);
+    assert(msg == 0);
+    AC_AWAIT(ac_subscribe_to(CHAN_REQUEST));
+    assert(msg != 0 && msg->foo[0] == 2);
+    assert(g_held->foo[0] == 1);
+
+    /* Swap back and forth, then free the parked one. */
+    msg = ac_slot_swap(0);
+    assert(msg == g_held);
+    msg = ac_slot_swap(0);
+    assert(msg->foo[0] == 2);
+    ac_slot_free(0);
+    ac_slot_swap(0);
+    assert(ac_slot_swap(0) == msg);
+
+    /* Invalid slot is ignored. */
+    assert(ac_slot_swap(AC_MSG_SLOTS) == msg);
+
+    /* Messages held in slots are released by the exception. */
+    ac_slot_swap(1);
+    return 0xffffffff;
+    AC_ACTOR_END;
+}
+
+uint32_t client(void* arg) {
+    for (uint32_t i = 1; i <= 2; ++i) {
+        struct demo_msg_t* const msg = ac_try_pop(CHAN_POOL);
+        assert(msg != 0);
+        msg->foo[0] = i;
+        ac_push(CHAN_REQUEST);
+    }
+
+    return ac_sleep_for(1);
+}
+
+int main(void) {
+    ac_context_init();
+    static uint8_t stack0[512];
+    static uint8_t stack1[512];
+    ac_context_stack_set(0, sizeof(stack0), stack0);
+    ac_context_stack_set(1, sizeof(stack1), stack1);
+
+    static alignas(sizeof(struct demo_msg_t)) struct demo_msg_t g_pool[2];
+    ac_channel_init_ex(&g_chan[CHAN_POOL], sizeof(g_pool), g_pool, sizeof(g_pool[0]));
+    ac_channel_init(&g_chan[CHAN_REQUEST]);
+
+    static struct ac_actor_t g_client;
+    struct ac_actor_descr_t client_descr = { (uintptr_t) client, 32, 0, 0 };
+    ac_actor_init(&g_client, 0, &client_descr);
+
+    static struct ac_actor_t g_server;
+    struct ac_actor_descr_t server_descr = { (uintptr_t) server, 32, 0, 0 };
+    ac_actor_init(&g_server, 1, &server_descr);
+
+    ac_port_swi_handler();
+    assert(g_errors == 1);
+
+    /* Both messages are returned into the pool. */
+    assert(mg_queue_pop(&g_chan[CHAN_POOL].base.queue, 0) != 0);
+    assert(mg_queue_pop(&g_chan[CHAN_POOL].base.queue, 0) != 0);
+    assert(g_server.slots[0].msg == 0 && g_server.slots[1].msg == 0);
+    return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ *  @file   periodic.c
+ *  @brief  Periodic releases land on the period boundaries despite latency.
+ */
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <assert.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context;
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor,
+    unsigned int handle,
+    bool is_write
+) {
+    return 0;
+}
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+enum {
+    PERIOD = 5,
+    END_TIME = 40,
+    MAX_WAKES = END_TIME + 1,
+};
+
+static uint32_t g_wakes[MAX_WAKES];
+static unsigned int g_wakes_num;
+
+uint32_t control(void* arg) {
+    g_wakes[g_wakes_num++] = g_time_now;
+    return ac_sleep_periodic(PERIOD);
+}
+
+/*
+ * The actor is held back as if preempted: the release at 15 runs 3 ticks
+ * late, the one at 25 overruns the next release at 30.
+ */
+static bool held(uint32_t t) {
+    return (t >= 15 && t < 18) || (t >= 25 && t < 33);
+}
+
+int main(void) {
+    static uint8_t stack[256];
+    static uint8_t sram[64];
+    static struct ac_actor_t g_actor;
+    const uint32_t expected[] = { 0, 5, 10, 18, 20, 33, 35, 40 };
+
+    ac_context_init();
+
+    struct ac_actor_descr_t descr = { (uintptr_t) control, 32, (uintptr_t) sram, 64 };
+    ac_context_stack_set(1, sizeof(stack), stack);
+    ac_actor_init(&g_actor, 1, &descr);
+    ac_port_swi_handler();
+
+    for (g_time_now = 1; g_time_now <= END_TIME; ++g_time_now) {
+        const bool expired = g_timer_armed && (g_timer_deadline <= g_time_now);
+
+        if (!AC_TICKLESS || expired) {
+            ac_context_tick();
+        }
+
+        if (g_req && !held(g_time_now)) {
+            ac_port_swi_handler();
+        }
+    }
+
+    assert(g_wakes_num == sizeof(expected) / sizeof(expected[0]));
+
+    for (unsigned int i = 0; i < g_wakes_num; ++i) {
+        assert(g_wakes[i] == expected[i]);
+    }
+
+    /* Restarted actor starts a new phase at the current tick. */
+    ac_actor_restart(&g_actor);
+    assert(g_actor.period == 0);
+    ac_port_swi_handler();
+    assert(g_wakes_num == sizeof(expected) / sizeof(expected[0]) + 1);
+    assert(g_actor.release == _ac_timed_now(AC_GET_CONTEXT()) + PERIOD);
+
+    return 0;
+}
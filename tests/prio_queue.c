@@ -0,0 +1,140 @@
+/*
+ *  @file   prio_queue.c
+ *  @brief  Priority-ordered channel: urgent messages overtake bulk ones.
+ */
+
+#include <stdio.h>
+#include <stdalign.h>
+#include <setjmp.h>
+#include <assert.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context; 
+
+enum {
+    CHAN_POOL,
+    CHAN_CMD,
+    CHAN_WORK,
+};
+
+static struct ac_channel_t g_chan[3];
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor, 
+    unsigned int handle,
+    bool is_write
+) {
+    const size_t max_id = sizeof(g_chan) / sizeof(g_chan[0]);
+    return (handle < max_id) ? &g_chan[handle] : 0;
+}
+
+struct demo_msg_t {
+    struct ac_message_t header;
+    uint32_t foo[9];
+};
+
+_Static_assert(sizeof(struct demo_msg_t) == 64, "wrong msg size");
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+enum {
+    MSG_NUM = 6,
+    WORKERS = 2,
+};
+
+/* Priorities of the messages in order of sending. */
+static const uint16_t g_prio[MSG_NUM] = { 0, 0, 0, 5, 0, 2 };
+
+/* Expected order of receiving: by priority, then FIFO. */
+static const uint32_t g_order[MSG_NUM] = { 3, 5, 0, 1, 2, 4 };
+
+static unsigned int g_received;
+static unsigned int g_worked[WORKERS];
+
+uint32_t server(void* arg) {
+    const struct demo_msg_t* const msg = arg;
+
+    if (msg) {
+        assert(msg->foo[0] == g_order[g_received]);
+        assert(msg->header.chan == CHAN_CMD);
+        ++g_received;
+    }
+
+    return ac_subscribe_to(CHAN_CMD);
+}
+
+/* Workers outrank the client, so both of them wait when it pushes. */
+static uint32_t worker(unsigned int i, void* arg) {
+    if (arg) {
+        ++g_worked[i];
+    }
+
+    return ac_subscribe_to(CHAN_WORK);
+}
+
+uint32_t worker0(void* arg) { return worker(0, arg); }
+uint32_t worker1(void* arg) { return worker(1, arg); }
+
+/* Client outranks the server so all the messages are queued first. */
+uint32_t client(void* arg) {
+    for (uint32_t i = 0; i < MSG_NUM; ++i) {
+        struct demo_msg_t* const msg = ac_try_pop(CHAN_POOL);
+        assert(msg != 0);
+        msg->foo[0] = i;
+        msg->header.prio = g_prio[i];
+        ac_push(CHAN_CMD);
+    }
+
+    for (uint32_t i = 0; i < WORKERS; ++i) {
+        assert(ac_try_pop(CHAN_POOL) != 0);
+        ac_push(CHAN_WORK);
+    }
+
+    return ac_sleep_for(1);
+}
+
+int main(void) {
+    ac_context_init();
+    static uint8_t stack0[512];
+    static uint8_t stack1[512];
+    static uint8_t stack2[512];
+    ac_context_stack_set(0, sizeof(stack0), stack0);
+    ac_context_stack_set(1, sizeof(stack1), stack1);
+    ac_context_stack_set(2, sizeof(stack2), stack2);
+
+    static alignas(sizeof(struct demo_msg_t)) struct demo_msg_t g_pool[MSG_NUM + WORKERS];
+    static struct ac_prio_queue_t g_queue;
+    static struct ac_prio_queue_t g_work_queue;
+    ac_channel_init_ex(&g_chan[CHAN_POOL], sizeof(g_pool), g_pool, sizeof(g_pool[0]));
+    ac_channel_init_prio(&g_chan[CHAN_CMD], 0, 0, 0, &g_queue);
+    ac_channel_init_prio(&g_chan[CHAN_WORK], 0, 0, 0, &g_work_queue);
+
+    static struct ac_actor_t g_server;
+    struct ac_actor_descr_t server_descr = { (uintptr_t) server, 32, 0, 0 };
+    ac_actor_init(&g_server, 0, &server_descr);
+
+    static struct ac_actor_t g_client;
+    struct ac_actor_descr_t client_descr = { (uintptr_t) client, 32, 0, 0 };
+    ac_actor_init(&g_client, 1, &client_descr);
+
+    static struct ac_actor_t g_workers[WORKERS];
+    uint32_t (* const workers[WORKERS])(void*) = { worker0, worker1 };
+
+    for (unsigned int i = 0; i < WORKERS; ++i) {
+        struct ac_actor_descr_t worker_descr = { (uintptr_t) workers[i], 32, 0, 0 };
+        ac_actor_init(&g_workers[i], 2, &worker_descr);
+    }
+
+    ac_port_swi_handler();
+    assert(g_received == MSG_NUM);
+    assert(g_queue.bitmap == 0);
+
+    /* Each waiting worker gets its own message. */
+    assert(g_worked[0] == 1 && g_worked[1] == 1);
+    assert(g_work_queue.bitmap == 0);
+    return 0;
+}
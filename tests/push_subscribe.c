@@ -0,0 +1,105 @@
+/*
+ *  @file   push_subscribe.c
+ *  @brief  Request-reply round trip using the combined push/subscribe call.
+ */
+
+#include <stdio.h>
+#include <stdalign.h>
+#include <setjmp.h>
+#include <assert.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context; 
+
+enum {
+    CHAN_REQUEST,
+    CHAN_REPLY,
+    CHAN_READY_REPLY,
+    CHAN_SINK,
+};
+
+static struct ac_channel_t g_chan[4];
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor, 
+    unsigned int handle,
+    bool is_write
+) {
+    const size_t max_id = sizeof(g_chan) / sizeof(g_chan[0]);
+    return (handle < max_id) ? &g_chan[handle] : 0;
+}
+
+struct demo_msg_t {
+    struct ac_message_t header;
+    uint32_t foo[9];
+};
+
+_Static_assert(sizeof(struct demo_msg_t) == 64, "wrong msg size");
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+static unsigned int g_replies;
+
+uint32_t server(void* arg) {
+    struct demo_msg_t* msg = arg;
+
+    if (msg) {
+        msg->foo[0] += 1;
+        ac_push(CHAN_REPLY);
+    }
+
+    return ac_subscribe_to(CHAN_REQUEST);
+}
+
+uint32_t client(void* arg) {
+    struct demo_msg_t* msg = arg;
+    AC_ACTOR_START;
+    msg = ac_try_pop(CHAN_REPLY);
+    assert(msg != 0);
+    msg->foo[0] = 41;
+    AC_AWAIT(ac_push_and_subscribe(CHAN_REQUEST, CHAN_REPLY));
+    assert(msg != 0);
+    assert(msg->foo[0] == 42);
+    ++g_replies;
+
+    /* Reply is already available so the call is completed synchronously. */
+    AC_AWAIT(ac_push_and_subscribe(CHAN_SINK, CHAN_READY_REPLY));
+    assert(msg != 0);
+    assert(msg->foo[0] == 0xc0cac01a);
+    ++g_replies;
+    ac_free();
+    AC_AWAIT(ac_sleep_for(1));
+    AC_ACTOR_END;
+}
+
+int main(void) {
+    ac_context_init();
+    static uint8_t stack0[512];
+    static uint8_t stack1[512];
+    ac_context_stack_set(0, sizeof(stack0), stack0);
+    ac_context_stack_set(1, sizeof(stack1), stack1);
+
+    static alignas(sizeof(struct demo_msg_t)) struct demo_msg_t g_reply[1];
+    static alignas(sizeof(struct demo_msg_t)) struct demo_msg_t g_ready[1];
+    g_ready[0].foo[0] = 0xc0cac01a;
+    ac_channel_init(&g_chan[CHAN_REQUEST]);
+    ac_channel_init_ex(&g_chan[CHAN_REPLY], sizeof(g_reply), g_reply, sizeof(g_reply[0]));
+    ac_channel_init_ex(&g_chan[CHAN_READY_REPLY], sizeof(g_ready), g_ready, sizeof(g_ready[0]));
+    ac_channel_init(&g_chan[CHAN_SINK]);
+    
+    static struct ac_actor_t g_client;
+    struct ac_actor_descr_t client_descr = { (uintptr_t) client, 32, 0, 0 };
+    ac_actor_init(&g_client, 0, &client_descr);
+
+    static struct ac_actor_t g_server;
+    struct ac_actor_descr_t server_descr = { (uintptr_t) server, 32, 0, 0 };
+    ac_actor_init(&g_server, 1, &server_descr);
+
+    ac_port_swi_handler();
+    assert(g_replies == 2);
+    return 0;
+}
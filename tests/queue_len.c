@@ -62,8 +62,8 @@ int main(void) {
     ac_context_stack_set(0, sizeof(stack0), stack0);
 
     static alignas(sizeof(struct demo_msg_t)) struct demo_msg_t g_storage[2];
-    ac_channel_init_ex(&g_chan[0], sizeof(g_storage), g_storage, sizeof(g_storage[0]), 1);
-    ac_channel_init(&g_chan[1], 1);
+    ac_channel_init_ex(&g_chan[0], sizeof(g_storage), g_storage, sizeof(g_storage[0]));
+    ac_channel_init(&g_chan[1]);
     
     static struct ac_actor_t g_actor;
     struct ac_actor_descr_t descr = { (uintptr_t) actor1, 32, 0, 0 };
@@ -0,0 +1,161 @@
+/*
+ *  @file   select.c
+ *  @brief  Waiting for a message from any channel of the set.
+ */
+
+#include <stdio.h>
+#include <stdalign.h>
+#include <setjmp.h>
+#include <assert.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context; 
+
+enum {
+    CHAN_POOL,
+    CHAN_SINK,
+    CHAN_REQUEST,
+    CHAN_READY,
+    CHAN_BUSY,
+};
+
+static struct ac_channel_t g_chan[5];
+static bool g_inject;
+
+struct demo_msg_t {
+    struct ac_message_t header;
+    uint32_t foo[9];
+};
+
+/* Interrupt handler pushing into the channel while the selector polls it. */
+static void inject(void) {
+    struct demo_msg_t* const msg = (void*) mg_message_alloc(&g_chan[CHAN_POOL].base);
+    assert(msg != 0);
+    msg->foo[0] = 2;
+    g_inject = false;
+    ac_channel_push(&g_chan[CHAN_REQUEST], &msg->header);
+}
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor, 
+    unsigned int handle,
+    bool is_write
+) {
+    const size_t max_id = sizeof(g_chan) / sizeof(g_chan[0]);
+
+    if (g_inject && actor && (actor->select & AC_SELECT_POLL)) {
+        inject();
+    }
+
+    return (handle < max_id) ? &g_chan[handle] : 0;
+}
+
+_Static_assert(sizeof(struct demo_msg_t) == 64, "wrong msg size");
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+static unsigned int g_received;
+static struct ac_actor_t g_server;
+static struct ac_actor_t g_holder;
+
+uint32_t server(void* arg) {
+    struct demo_msg_t* msg = arg;
+    const uint32_t set = 1 | (1 << (CHAN_READY - CHAN_REQUEST));
+    AC_ACTOR_START;
+
+    /* Message is already available so the select is completed synchronously. */
+    AC_AWAIT(ac_select(CHAN_REQUEST, set));
+    assert(msg != 0);
+    assert(msg->header.chan == CHAN_READY);
+    assert(msg->foo[0] == 0xc0cac01a);
+    ac_push(CHAN_SINK);
+    ++g_received;
+
+    /* Both channels are empty so the server is blocked until the push. */
+    AC_AWAIT(ac_select(CHAN_REQUEST, set));
+    assert(msg != 0);
+    assert(msg->header.chan == CHAN_REQUEST);
+    assert(msg->foo[0] == 42);
+    assert(g_chan[CHAN_READY].selector == 0);
+    ++g_received;
+
+    /* Message pushed during the poll is queued after the one already there. */
+    msg->foo[0] = 1;
+    ac_push(CHAN_REQUEST);
+    g_inject = true;
+    AC_AWAIT(ac_select(CHAN_REQUEST, set));
+    assert(msg != 0);
+    assert(msg->foo[0] == 1);
+    AC_AWAIT(ac_select(CHAN_REQUEST, set));
+    assert(msg != 0);
+    assert(msg->foo[0] == 2);
+    assert(!g_inject);
+    ++g_received;
+
+    /* Set with no valid channel completes at once instead of blocking. */
+    AC_AWAIT(ac_select(sizeof(g_chan) / sizeof(g_chan[0]), 1));
+    assert(msg == 0);
+    assert(g_server.select == 0);
+
+    /* Channel another actor waits for is skipped, so is the invalid one. */
+    AC_AWAIT(ac_select(CHAN_BUSY, 1 | 2));
+    assert(msg == 0);
+    assert(g_chan[CHAN_BUSY].selector == 0);
+    assert(g_chan[CHAN_BUSY].waiters == &g_holder);
+    ++g_received;
+    AC_AWAIT(ac_sleep_for(1));
+    AC_ACTOR_END;
+}
+
+/* Holder outranks the others and waits for the channel all the time. */
+uint32_t holder(void* arg) {
+    assert(arg == 0);
+    return ac_subscribe_timed(CHAN_BUSY, 1000);
+}
+
+uint32_t client(void* arg) {
+    struct demo_msg_t* const msg = ac_try_pop(CHAN_POOL);
+    assert(msg != 0);
+    assert(msg->header.chan == CHAN_POOL);
+    msg->foo[0] = 42;
+    assert(g_chan[CHAN_REQUEST].selector != 0);
+    ac_push(CHAN_REQUEST);
+    return ac_sleep_for(1);
+}
+
+int main(void) {
+    ac_context_init();
+    static uint8_t stack0[512];
+    static uint8_t stack1[512];
+    static uint8_t stack2[512];
+    ac_context_stack_set(0, sizeof(stack0), stack0);
+    ac_context_stack_set(1, sizeof(stack1), stack1);
+    ac_context_stack_set(2, sizeof(stack2), stack2);
+
+    static alignas(sizeof(struct demo_msg_t)) struct demo_msg_t g_pool[2];
+    static alignas(sizeof(struct demo_msg_t)) struct demo_msg_t g_ready[1];
+    g_ready[0].foo[0] = 0xc0cac01a;
+    ac_channel_init_ex(&g_chan[CHAN_POOL], sizeof(g_pool), g_pool, sizeof(g_pool[0]));
+    ac_channel_init(&g_chan[CHAN_SINK]);
+    ac_channel_init(&g_chan[CHAN_REQUEST]);
+    ac_channel_init_ex(&g_chan[CHAN_READY], sizeof(g_ready), g_ready, sizeof(g_ready[0]));
+    ac_channel_init(&g_chan[CHAN_BUSY]);
+
+    struct ac_actor_descr_t holder_descr = { (uintptr_t) holder, 32, 0, 0 };
+    ac_actor_init(&g_holder, 2, &holder_descr);
+
+    struct ac_actor_descr_t server_descr = { (uintptr_t) server, 32, 0, 0 };
+    ac_actor_init(&g_server, 1, &server_descr);
+
+    static struct ac_actor_t g_client;
+    struct ac_actor_descr_t client_descr = { (uintptr_t) client, 32, 0, 0 };
+    ac_actor_init(&g_client, 0, &client_descr);
+
+    ac_port_swi_handler();
+    assert(g_received == 4);
+    return 0;
+}
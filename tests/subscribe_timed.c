@@ -0,0 +1,116 @@
+/*
+ *  @file   subscribe_timed.c
+ *  @brief  Subscribe completed either by a message or by the timeout.
+ */
+
+#include <stdio.h>
+#include <stdalign.h>
+#include <setjmp.h>
+#include <assert.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context; 
+
+enum {
+    CHAN_POOL,
+    CHAN_REQUEST,
+};
+
+static struct ac_channel_t g_chan[2];
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor, 
+    unsigned int handle,
+    bool is_write
+) {
+    const size_t max_id = sizeof(g_chan) / sizeof(g_chan[0]);
+    return (handle < max_id) ? &g_chan[handle] : 0;
+}
+
+struct demo_msg_t {
+    struct ac_message_t header;
+    uint32_t foo[9];
+};
+
+_Static_assert(sizeof(struct demo_msg_t) == 64, "wrong msg size");
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+static unsigned int g_ticks;
+static unsigned int g_timeouts;
+static unsigned int g_received;
+
+uint32_t server(void* arg) {
+    struct demo_msg_t* msg = arg;
+    AC_ACTOR_START;
+
+    /* Nobody sends anything so the timeout expires first. */
+    AC_AWAIT(ac_subscribe_timed(CHAN_REQUEST, 3));
+    assert(msg == 0);
+    assert(g_ticks == 3);
+    ++g_timeouts;
+
+    /* Message arrives before the timeout which is cancelled then. */
+    AC_AWAIT(ac_subscribe_timed(CHAN_REQUEST, 10));
+    assert(msg != 0);
+    assert(msg->header.chan == CHAN_REQUEST);
+    assert(msg->foo[0] == 42);
+    assert(g_ac_context.per_cpu_data[0].timed == 0);
+    ++g_received;
+
+    /* Zero timeout is just polling. */
+    AC_AWAIT(ac_subscribe_timed(CHAN_REQUEST, 0));
+    assert(msg == 0);
+    AC_AWAIT(ac_subscribe_to(CHAN_REQUEST));
+    AC_ACTOR_END;
+}
+
+uint32_t client(void* arg) {
+    AC_ACTOR_START;
+    AC_AWAIT(ac_sleep_for(5));
+    struct demo_msg_t* const msg = ac_try_pop(CHAN_POOL);
+    assert(msg != 0);
+    msg->foo[0] = 42;
+    ac_push(CHAN_REQUEST);
+    AC_AWAIT(ac_sleep_for(100));
+    AC_ACTOR_END;
+}
+
+int main(void) {
+    ac_context_init();
+    static uint8_t stack0[512];
+    static uint8_t stack1[512];
+    ac_context_stack_set(0, sizeof(stack0), stack0);
+    ac_context_stack_set(1, sizeof(stack1), stack1);
+
+    static alignas(sizeof(struct demo_msg_t)) struct demo_msg_t g_pool[1];
+    ac_channel_init_ex(&g_chan[CHAN_POOL], sizeof(g_pool), g_pool, sizeof(g_pool[0]));
+    ac_channel_init(&g_chan[CHAN_REQUEST]);
+
+    static struct ac_actor_t g_server;
+    struct ac_actor_descr_t server_descr = { (uintptr_t) server, 32, 0, 0 };
+    ac_actor_init(&g_server, 1, &server_descr);
+
+    static struct ac_actor_t g_client;
+    struct ac_actor_descr_t client_descr = { (uintptr_t) client, 32, 0, 0 };
+    ac_actor_init(&g_client, 0, &client_descr);
+
+    ac_port_swi_handler();
+
+    /* Cancelled timeout must not activate the server later. */
+    for (g_ticks = 1; g_ticks <= 20; ++g_ticks) {
+        ac_context_tick();
+
+        if (g_req) {
+            ac_port_swi_handler();
+        }
+    }
+
+    assert(g_timeouts == 1);
+    assert(g_received == 1);
+    return 0;
+}
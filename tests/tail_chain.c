@@ -0,0 +1,83 @@
+/*
+ *  @file   tail_chain.c
+ *  @brief  Burst of actors at the same level with and without tail-chaining.
+ */
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <assert.h>
+#include <time.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context;
+
+enum {
+    WORKERS = 32,
+    ROUNDS = 1000,
+};
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor,
+    unsigned int handle,
+    bool is_write
+) {
+    return 0;
+}
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+static unsigned int g_runs;
+
+uint32_t worker(void* arg) {
+    ++g_runs;
+    return ac_sleep_for(1);
+}
+
+/*
+ * Each round activates all the workers at once by the tick. Returns the
+ * number of interrupt entries.
+ */
+static unsigned int bench(bool chain) {
+    const unsigned int entries = g_swi_entries;
+    const unsigned int runs = g_runs;
+    const clock_t start = clock();
+    g_handoff = chain;
+
+    for (unsigned int i = 0; i < ROUNDS; ++i) {
+        ac_context_tick();
+
+        if (g_req) {
+            ac_port_swi_handler();
+        }
+    }
+
+    const double ns = (double) (clock() - start) * 1e9 / CLOCKS_PER_SEC;
+    const unsigned int result = g_swi_entries - entries;
+    assert(g_runs - runs == ROUNDS * WORKERS);
+    printf("tail-chain %s: %.1f ns per activation, %.2f interrupts per burst\n",
+        chain ? "on" : "off", ns / (ROUNDS * WORKERS), (double) result / ROUNDS);
+    return result;
+}
+
+int main(void) {
+    ac_context_init();
+    static uint8_t stack1[512];
+    ac_context_stack_set(1, sizeof(stack1), stack1);
+
+    static struct ac_actor_t g_worker[WORKERS];
+    struct ac_actor_descr_t descr = { (uintptr_t) worker, 32, 0, 0 };
+
+    for (unsigned int i = 0; i < WORKERS; ++i) {
+        ac_actor_init(&g_worker[i], 1, &descr);
+    }
+
+    ac_port_swi_handler();
+    assert(g_runs == WORKERS);
+    assert(bench(false) == ROUNDS * WORKERS);
+    assert(bench(true) == ROUNDS);
+    return 0;
+}
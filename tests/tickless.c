@@ -0,0 +1,104 @@
+/*
+ *  @file   tickless.c
+ *  @brief  Tickless timeouts expire at the same ticks as the ticked ones.
+ */
+
+#ifndef AC_TICKLESS
+#define AC_TICKLESS 1
+#endif
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <assert.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context;
+
+static struct ac_channel_t g_chan;
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor,
+    unsigned int handle,
+    bool is_write
+) {
+    return (handle == 0) ? &g_chan : 0;
+}
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+enum {
+    END_TIME = 30,
+    MAX_WAKES = END_TIME + 1,
+};
+
+static uint32_t g_wakes[3][MAX_WAKES];
+static unsigned int g_wakes_num[3];
+
+static void wake_record(unsigned int i) {
+    g_wakes[i][g_wakes_num[i]++] = g_time_now;
+}
+
+uint32_t fast(void* arg) {
+    wake_record(0);
+    return ac_sleep_for(3);
+}
+
+uint32_t slow(void* arg) {
+    wake_record(1);
+    return ac_sleep_for(5);
+}
+
+/* Nothing is pushed into the channel, so each wait ends with the timeout. */
+uint32_t waiter(void* arg) {
+    assert(arg == 0);
+    wake_record(2);
+    return ac_subscribe_timed(0, 7);
+}
+
+int main(void) {
+    static uint8_t stacks[3][256];
+    static uint8_t sram[64];
+    static struct ac_actor_t g_actors[3];
+    uint32_t (* const funcs[3])(void*) = { fast, slow, waiter };
+    const uint32_t periods[3] = { 3, 5, 7 };
+    unsigned int interrupts = 0;
+
+    ac_context_init();
+    ac_channel_init(&g_chan);
+
+    for (unsigned int i = 0; i < 3; ++i) {
+        struct ac_actor_descr_t descr = { (uintptr_t) funcs[i], 32, (uintptr_t) sram, 64 };
+        ac_context_stack_set(i + 1, sizeof(stacks[i]), stacks[i]);
+        ac_actor_init(&g_actors[i], i + 1, &descr);
+        ac_port_swi_handler();
+    }
+
+    for (g_time_now = 1; g_time_now <= END_TIME; ++g_time_now) {
+        const bool expired = g_timer_armed && (g_timer_deadline <= g_time_now);
+
+        if (!AC_TICKLESS || expired) {
+            ++interrupts;
+            ac_context_tick();
+
+            if (g_req) {
+                ac_port_swi_handler();
+            }
+        }
+    }
+
+    for (unsigned int i = 0; i < 3; ++i) {
+        assert(g_wakes_num[i] == END_TIME / periods[i] + 1);
+
+        for (unsigned int j = 0; j < g_wakes_num[i]; ++j) {
+            assert(g_wakes[i][j] == j * periods[i]);
+        }
+    }
+
+    /* Only the ticks some timeout expires at: multiples of 3, 5 or 7. */
+    assert(!AC_TICKLESS || interrupts == 17);
+    return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ *  @file   timer_slack.c
+ *  @brief  Delays with slack expire within the slack and share interrupts.
+ */
+
+#ifndef AC_TICKLESS
+#define AC_TICKLESS 1
+#endif
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <assert.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context;
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor,
+    unsigned int handle,
+    bool is_write
+) {
+    return 0;
+}
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+enum {
+    ACTORS = 8,
+    DELAY = 100,
+    SLACK = 32,
+    END_TIME = 2000,
+};
+
+static uint32_t g_last[ACTORS];
+static unsigned int g_wakes;
+
+/* Each actor sleeps for a slightly different time. */
+static uint32_t sleeper(unsigned int i, void* arg) {
+    const uint32_t delay = DELAY + i * 3;
+
+    if (g_time_now != 0) {
+        assert(g_time_now - g_last[i] >= delay);
+        assert(g_time_now - g_last[i] <= delay + SLACK);
+        ++g_wakes;
+    }
+
+    g_last[i] = g_time_now;
+    return ac_sleep_for_slack(delay, SLACK);
+}
+
+uint32_t s0(void* arg) { return sleeper(0, arg); }
+uint32_t s1(void* arg) { return sleeper(1, arg); }
+uint32_t s2(void* arg) { return sleeper(2, arg); }
+uint32_t s3(void* arg) { return sleeper(3, arg); }
+uint32_t s4(void* arg) { return sleeper(4, arg); }
+uint32_t s5(void* arg) { return sleeper(5, arg); }
+uint32_t s6(void* arg) { return sleeper(6, arg); }
+uint32_t s7(void* arg) { return sleeper(7, arg); }
+
+int main(void) {
+    static uint8_t stacks[ACTORS][256];
+    static uint8_t sram[64];
+    static struct ac_actor_t g_actors[ACTORS];
+    uint32_t (* const funcs[ACTORS])(void*) = { s0, s1, s2, s3, s4, s5, s6, s7 };
+    unsigned int interrupts = 0;
+
+    ac_context_init();
+
+    for (unsigned int i = 0; i < ACTORS; ++i) {
+        struct ac_actor_descr_t descr = { (uintptr_t) funcs[i], 32, (uintptr_t) sram, 64 };
+        ac_context_stack_set(i + 1, sizeof(stacks[i]), stacks[i]);
+        ac_actor_init(&g_actors[i], i + 1, &descr);
+        ac_port_swi_handler();
+    }
+
+    for (g_time_now = 1; g_time_now <= END_TIME; ++g_time_now) {
+        const bool expired = g_timer_armed && (g_timer_deadline <= g_time_now);
+
+        if (!AC_TICKLESS || expired) {
+            ++interrupts;
+            ac_context_tick();
+
+            if (g_req) {
+                ac_port_swi_handler();
+            }
+        }
+    }
+
+    /* Without the slack each actor would need its own interrupt. */
+    printf("timer slack: %u wakeups, %u interrupts\n", g_wakes, interrupts);
+    assert(g_wakes >= ACTORS * (END_TIME / (DELAY + SLACK + ACTORS * 3)));
+    assert(!AC_TICKLESS || interrupts * 4 <= g_wakes);
+    return 0;
+}
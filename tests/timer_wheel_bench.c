@@ -0,0 +1,96 @@
+/*
+ *  @file   timer_wheel_bench.c
+ *  @brief  Tick cost with thousands of waiting actors.
+ */
+
+#ifndef AC_TIMER_WHEEL
+#define AC_TIMER_WHEEL 1
+#endif
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <assert.h>
+#include <time.h>
+#include "ac_core.h"          /* kernel API */
+#include "usr/c/actinium.h"   /* user API */
+
+struct mg_context_t g_mg_context;
+struct ac_context_t g_ac_context;
+
+enum {
+    ACTORS_NUM = 10000,
+    TICKS_NUM = 20000,
+};
+
+static struct ac_channel_t g_chan;
+static struct ac_actor_t g_actors[ACTORS_NUM];
+static uint32_t g_expected[ACTORS_NUM];
+static uint32_t g_now;
+static unsigned int g_activations;
+
+struct ac_channel_t* ac_channel_validate(
+    struct ac_actor_t* actor,
+    unsigned int handle,
+    bool is_write
+) {
+    return (handle == 0) ? &g_chan : 0;
+}
+
+void ac_actor_error(struct ac_actor_t* actor) {
+    assert(0);
+}
+
+//
+// Periods are long enough to make the timer bookkeeping dominate over the
+// activations. Half of the actors are delayed, the rest waits for a message
+// with the timeout, delays use magnesium timers without the wheel.
+//
+uint32_t sleeper(void* arg) {
+    const size_t i = AC_GET_CONTEXT()->running_actor - g_actors;
+    const uint32_t period = 1000 + (i * 7919) % 15000;
+
+    assert(g_expected[i] == g_now);
+    g_expected[i] = g_now + period;
+    ++g_activations;
+
+    return (AC_TIMER_WHEEL && (i & 1)) ? ac_sleep_for(period) : ac_subscribe_timed(0, period);
+}
+
+int main(void) {
+    static uint8_t stack[256];
+    static uint8_t sram[64];
+    struct ac_actor_descr_t descr = { (uintptr_t) sleeper, 32, (uintptr_t) sram, 64 };
+
+    ac_context_init();
+    ac_channel_init(&g_chan);
+    ac_context_stack_set(1, sizeof(stack), stack);
+
+    for (unsigned int i = 0; i < ACTORS_NUM; ++i) {
+        ac_actor_init(&g_actors[i], 1, &descr);
+        ac_port_swi_handler();
+    }
+
+    const clock_t start = clock();
+
+    for (g_now = 1; g_now <= TICKS_NUM; ++g_now) {
+        ac_context_tick();
+
+        if (g_req) {
+            ac_port_swi_handler();
+        }
+    }
+
+    const double ns = (double) (clock() - start) * 1e9 / CLOCKS_PER_SEC;
+    unsigned int expected = ACTORS_NUM;
+
+    for (unsigned int i = 0; i < ACTORS_NUM; ++i) {
+        const uint32_t period = 1000 + (i * 7919) % 15000;
+        expected += TICKS_NUM / period;
+    }
+
+    assert(g_activations == expected);
+    printf("timer wheel %s: %.1f ns per tick, %u actors, %.2f activations per tick\n",
+        AC_TIMER_WHEEL ? "on" : "off", ns / TICKS_NUM, ACTORS_NUM, 
+        (double) (g_activations - ACTORS_NUM) / TICKS_NUM);
+    return 0;
+}
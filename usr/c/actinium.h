@@ -15,6 +15,21 @@ enum {
     AC_SYSCALL_TRY_POP,
     AC_SYSCALL_PUSH,
     AC_SYSCALL_FREE,
+    AC_SYSCALL_PUSH_SUBSCRIBE,
+    AC_SYSCALL_SLOT,
+    AC_SYSCALL_SELECT,
+    AC_SYSCALL_SUBSCRIBE_TIMED,
+    AC_SYSCALL_NOTIFY,
+    AC_SYSCALL_PERIODIC,
+    AC_SYSCALL_DELAY_US,
+    AC_SYSCALL_DELAY_SLACK,
+};
+
+enum {
+    AC_SYSCALL_CHAN_BITS = 14,
+    AC_SYSCALL_CHAN_MASK = (1 << AC_SYSCALL_CHAN_BITS) - 1,
+    AC_SYSCALL_SLOT_FREE = 0x100,
+    AC_SYSCALL_ARG_MAX = 0x0fffffff,
 };
 
 /* Tests may include both headers for kernel and user parts.
@@ -25,8 +40,9 @@ enum {
 
 struct ac_message_t {
     size_t size;
-    uintptr_t padding;
-    uintptr_t poisoned;
+    uintptr_t chan;
+    uint16_t poisoned;
+    uint16_t prio;
 };
 
 #endif
@@ -41,22 +57,141 @@ static inline uint32_t ac_sleep_for(uint32_t delay) {
     return _ac_syscall_val(AC_SYSCALL_DELAY, delay);
 }
 
+/*
+ * Delay which may be extended by up to 'slack' ticks, so the kernel merges 
+ * expirations of close delays into one. Slack is limited to 16383 ticks, 
+ * longer delays are plain ones.
+ */
+static inline uint32_t ac_sleep_for_slack(uint32_t delay, uint32_t slack) {
+    if (delay > AC_SYSCALL_CHAN_MASK) {
+        return ac_sleep_for(delay);
+    }
+
+    if (slack > AC_SYSCALL_CHAN_MASK) {
+        slack = AC_SYSCALL_CHAN_MASK;
+    }
+
+    const uint32_t arg = (slack << AC_SYSCALL_CHAN_BITS) | delay;
+    return _ac_syscall_val(AC_SYSCALL_DELAY_SLACK, arg);
+}
+
+/*
+ * Delay in microseconds, up to 2^28-1, longer delays are clamped. It is 
+ * exact when the kernel is built with the microsecond timer, otherwise it
+ * is rounded up to ticks.
+ */
+static inline uint32_t ac_sleep_us(uint32_t us) {
+    if (us > AC_SYSCALL_ARG_MAX) {
+        us = AC_SYSCALL_ARG_MAX;
+    }
+
+    return _ac_syscall_val(AC_SYSCALL_DELAY_US, us);
+}
+
+/*
+ * Sleeps until the next release of the period. Releases are spaced exactly
+ * by the period since the first call regardless of the actor's run time, 
+ * the releases missed by an overrun are skipped. The new period restarts 
+ * the phase, zero period stops it without sleeping. Periods are clamped to
+ * 2^28-1 ticks.
+ */
+static inline uint32_t ac_sleep_periodic(uint32_t period) {
+    if (period > AC_SYSCALL_ARG_MAX) {
+        period = AC_SYSCALL_ARG_MAX;
+    }
+
+    return _ac_syscall_val(AC_SYSCALL_PERIODIC, period);
+}
+
 static inline uint32_t ac_subscribe_to(unsigned int id) {
     return _ac_syscall_val(AC_SYSCALL_SUBSCRIBE, id);
 }
 
+/*
+ * Subscribes to the channel with the timeout in ticks, up to 16383, longer 
+ * timeouts are clamped. If the timeout expires first the actor is activated
+ * with no message. Zero timeout is the same as ac_try_pop.
+ */
+static inline uint32_t ac_subscribe_timed(unsigned int id, uint32_t ticks) {
+    if (ticks > AC_SYSCALL_CHAN_MASK) {
+        ticks = AC_SYSCALL_CHAN_MASK;
+    }
+
+    const uint32_t arg = (ticks << AC_SYSCALL_CHAN_BITS) | (id & AC_SYSCALL_CHAN_MASK);
+    return _ac_syscall_val(AC_SYSCALL_SUBSCRIBE_TIMED, arg);
+}
+
 static inline void* ac_try_pop(unsigned int id) {
     return _ac_syscall(_ac_syscall_val(AC_SYSCALL_TRY_POP, id));
 }
 
+/*
+ * Returns null when the message is pushed. Bounded channel rejects the push
+ * when it is full, the message remains owned and its pointer is returned.
+ */
 static inline void* ac_push(unsigned int id) {
     return _ac_syscall(_ac_syscall_val(AC_SYSCALL_PUSH, id));
 }
 
+/*
+ * Pushes the owned message into 'dst' and subscribes to 'src' using a single
+ * syscall. Like ac_subscribe_to it is intended to be returned from the actor.
+ * If the push is rejected the message is freed and the actor is activated 
+ * with no message.
+ */
+static inline uint32_t ac_push_and_subscribe(unsigned int dst, unsigned int src) {
+    const uint32_t arg = ((dst & AC_SYSCALL_CHAN_MASK) << AC_SYSCALL_CHAN_BITS) |
+        (src & AC_SYSCALL_CHAN_MASK);
+    return _ac_syscall_val(AC_SYSCALL_PUSH_SUBSCRIBE, arg);
+}
+
+/*
+ * Waits for the first message from any channel of the set. The set is given
+ * by the first channel id and the mask of up to 14 channels relative to it.
+ * Id of the channel the message was received from is stored in its 'chan'.
+ * Like ac_subscribe_to it is intended to be returned from the actor.
+ */
+static inline uint32_t ac_select(unsigned int base, uint32_t mask) {
+    const uint32_t arg = ((base & AC_SYSCALL_CHAN_MASK) << AC_SYSCALL_CHAN_BITS) |
+        (mask & AC_SYSCALL_CHAN_MASK);
+    return _ac_syscall_val(AC_SYSCALL_SELECT, arg);
+}
+
+/*
+ * Event channels carry bits instead of messages. Subscribing to such 
+ * channel starts the actor with the event bits as the argument, the owned
+ * message, if any, is kept. Polling takes the pending bits or returns zero.
+ * When the event channel is selected the actor is started with no message
+ * and should take the bits by polling. Actors may set only the lower 14 bits.
+ */
+static inline uint32_t ac_events_poll(unsigned int id) {
+    return (uint32_t) (uintptr_t) _ac_syscall(_ac_syscall_val(AC_SYSCALL_TRY_POP, id));
+}
+
+static inline void ac_notify(unsigned int id, uint32_t bits) {
+    const uint32_t arg = ((bits & AC_SYSCALL_CHAN_MASK) << AC_SYSCALL_CHAN_BITS) |
+        (id & AC_SYSCALL_CHAN_MASK);
+    (void) _ac_syscall(_ac_syscall_val(AC_SYSCALL_NOTIFY, arg));
+}
+
 static inline void ac_free(void) {
     (void) _ac_syscall(AC_SYSCALL_FREE << 28);
 }
 
+/*
+ * Message slots are available when the kernel is built with AC_MSG_SLOTS.
+ * Swap exchanges the owned message with the one held in the slot, either 
+ * may be absent. Returns the new owned message. Messages in slots remain
+ * accessible and are not released by pop/subscribe calls.
+ */
+static inline void* ac_slot_swap(unsigned int slot) {
+    return _ac_syscall(_ac_syscall_val(AC_SYSCALL_SLOT, slot));
+}
+
+static inline void ac_slot_free(unsigned int slot) {
+    (void) _ac_syscall(_ac_syscall_val(AC_SYSCALL_SLOT, slot | AC_SYSCALL_SLOT_FREE));
+}
+
 #define AC_ACTOR_START static int _ac_state = 0; switch(_ac_state) { case 0:
 #define AC_ACTOR_END } return 0
 #define AC_AWAIT(q) _ac_state = __LINE__; return (q); case __LINE__:
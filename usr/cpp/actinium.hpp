@@ -13,12 +13,31 @@
 #include <concepts>
 #include <type_traits>
 
+template<typename T> struct message;
+
+//
+// Because of hardware MPU restrictions, only power-2-sized regions are
+// allowed. Transferable message is defined as a message which size including
+// the header is equal to power of two. Since exact message types are
+// defined at user side and aren't known in advance this is implemented as
+// a concept, so user won't be able to instantiate channels with 
+// non-transferable types even without any asserts.
+//
+template<typename T> concept transferable = 
+    (sizeof(message<T>) & (sizeof(message<T>) - 1)) == 0;
+
+template<transferable T> class message_owner;
+
 class message_header {
 
 protected:
     std::uintptr_t size;
-    std::uintptr_t padding;
-    std::uintptr_t poisoned;
+    std::uintptr_t chan;
+    std::uint16_t poisoned;
+    std::uint16_t prio;
+
+    template<transferable T> friend class message_owner;
+    friend class selection;
 };
 
 static_assert(sizeof(message_header) == 12);
@@ -28,26 +47,26 @@ enum syscall_id {
     SUBSCRIBE = 1 << 28,
     TRY_POP =   2 << 28,
     MSG_PUSH =  3 << 28,
-    MSG_FREE =  4 << 28
+    MSG_FREE =  4 << 28,
+    MSG_CALL =  5 << 28,
+    SELECT =    7 << 28,
+    SUBSCRIBE_TIMED = 8u << 28,
+    NOTIFY =    9u << 28,
+    PERIODIC =  10u << 28,
+    DELAY_US =  11u << 28,
+    DELAY_SLACK = 12u << 28
 };
 
+static constexpr std::uint32_t chan_id_bits = 14;
+static constexpr std::uint32_t chan_id_mask = (1 << chan_id_bits) - 1;
+static constexpr std::uint32_t syscall_arg_max = 0x0fffffff;
+
 extern "C" message_header* _ac_syscall(std::uint32_t arg);
 
 template<typename T> struct message : message_header {
     T payload;
 };
 
-//
-// Because of hardware MPU restrictions, only power-2-sized regions are
-// allowed. Transferable message is defined as a message which size including
-// the header is equal to power of two. Since exact message types are
-// defined at user side and aren't known in advance this is implemented as
-// a concept, so user won't be able to instantiate channels with 
-// non-transferable types even without any asserts.
-//
-template<typename T> concept transferable = 
-    (sizeof(message<T>) & (sizeof(message<T>) - 1)) == 0;
-
 template<transferable T> class recv_channel;
 template<transferable T> class send_channel;
 
@@ -79,8 +98,17 @@ public:
         return ptr_->poisoned != 0;
     }
 
+    //
+    // Used by priority-ordered channels, higher priority messages are 
+    // received first.
+    //
+    void set_prio(std::uint16_t prio) {
+        ptr_->prio = prio;
+    }
+
     friend class recv_channel<T>;
-    friend class send_channel<T>;
+    template<transferable U> friend class send_channel;
+    friend class selection;
 };
 
 //
@@ -120,6 +148,8 @@ private:
 template<transferable T> class recv_channel {
     const std::uint32_t id_;
     
+    template<transferable U> friend class send_channel;
+
 public:
     constexpr auto pop() const {
         class awaitable {
@@ -145,6 +175,42 @@ public:
         return awaitable{id_};
     }
     
+    //
+    // Waits for a message at most the specified number of ticks (up to 
+    // 16383, longer ones are clamped). Empty result means the timeout has 
+    // expired first.
+    //
+    constexpr auto pop_for(std::uint32_t ticks) const {
+        class awaitable {
+            const task::promise_type* promise_;
+            const std::uint32_t syscall_;
+
+        public:    
+            constexpr bool await_ready() const { return false; }
+            
+            void await_suspend(std::coroutine_handle<task::promise_type> h) {
+                h.promise().syscall_arg = syscall_;
+                promise_ = &h.promise();
+            }
+            
+            std::optional<message_owner<T>> await_resume() const {
+                message_header* const msg = promise_->incoming_msg;
+
+                if (msg) {
+                    return message_owner<T>{static_cast<message<T>*>(msg)};
+                } else {
+                    return std::nullopt;
+                }
+            }
+                       
+            constexpr awaitable(std::uint32_t syscall) : 
+                promise_(nullptr), syscall_(syscall) {}
+        };
+        
+        const std::uint32_t t = ((ticks < chan_id_mask) ? ticks : chan_id_mask) << chan_id_bits;
+        return awaitable{syscall_id::SUBSCRIBE_TIMED | t | (id_ & chan_id_mask)};
+    }
+
     std::optional<message_owner<T>> try_pop() const {
         message_header* const msg = _ac_syscall(syscall_id::TRY_POP | id_);
 
@@ -155,32 +221,272 @@ public:
         }
     }    
     
+    constexpr std::uint32_t id() const { return id_; }
+
     consteval recv_channel(std::uint32_t ident) noexcept : id_(ident) {}
 };
 
+//
+// Message received by select from one of the channels of the set. It may be
+// converted into typed owner using the channel it was received from,
+// otherwise the message is freed when the selection is destroyed. Select 
+// completed with no message has no channel.
+//
+class selection {
+    message_header* ptr_;
+    std::optional<std::uint32_t> chan_;
+
+    selection(message_header* msg) noexcept : ptr_(msg) {
+        if (msg != nullptr) {
+            chan_ = msg->chan;
+        }
+    }
+
+public:
+    class awaitable {
+        const task::promise_type* promise_;
+        const std::uint32_t syscall_;
+
+    public:
+        // Zero syscall is the rejected set, it completes at once.
+        constexpr bool await_ready() const { return syscall_ == 0; }
+
+        void await_suspend(std::coroutine_handle<task::promise_type> h) {
+            h.promise().syscall_arg = syscall_;
+            promise_ = &h.promise();
+        }
+
+        selection await_resume() const {
+            return {promise_ ? promise_->incoming_msg : nullptr};
+        }
+
+        constexpr awaitable(std::uint32_t syscall) : 
+            promise_(nullptr), syscall_(syscall) {}
+    };
+
+    selection(selection&& other) noexcept : chan_(other.chan_) {
+        ptr_ = other.ptr_;
+        other.ptr_ = nullptr;
+    }
+
+    std::optional<std::uint32_t> channel() const { return chan_; }
+
+    template<transferable T> 
+    std::optional<message_owner<T>> from(const recv_channel<T>& chan) {
+        message_header* const msg = ptr_;
+
+        if (msg == nullptr || msg->chan != chan.id()) {
+            return std::nullopt;
+        }
+
+        ptr_ = nullptr;
+        return message_owner<T>{static_cast<message<T>*>(msg)};
+    }
+
+    ~selection() {
+        if (ptr_ != nullptr) {
+            ptr_ = nullptr;
+            (void) _ac_syscall(syscall_id::MSG_FREE);
+        }
+    }
+};
+
+//
+// Waits for a message from any of the channels. Channel ids must fit into
+// the window of 14 consecutive ids, otherwise the set is rejected and the 
+// select completes at once with no message.
+//
+template<transferable... T> constexpr auto select(const recv_channel<T>&... chans) {
+    std::uint32_t base = ~std::uint32_t(0);
+    std::uint32_t mask = 0;
+    ((base = (chans.id() < base) ? chans.id() : base), ...);
+
+    if (!((chans.id() <= chan_id_mask && chans.id() - base < chan_id_bits) && ...)) {
+        return selection::awaitable{0};
+    }
+
+    ((mask |= std::uint32_t(1) << (chans.id() - base)), ...);
+    const std::uint32_t arg = (base << chan_id_bits) | mask;
+    return selection::awaitable{syscall_id::SELECT | arg};
+}
+
 template<transferable T> class send_channel {
     const std::uint32_t id_;
     
 public:
-    void push(message_owner<T> msg) {
+    //
+    // Bounded channel returns the message back when it is full.
+    //
+    std::optional<message_owner<T>> push(message_owner<T> msg) {
         msg.drop(); /* Destructor won't free message at end of the function. */
-        (void) _ac_syscall(syscall_id::MSG_PUSH | id_);
+        message_header* const rejected = _ac_syscall(syscall_id::MSG_PUSH | id_);
+
+        if (rejected) {
+            return message_owner<T>{static_cast<message<T>*>(rejected)};
+        } else {
+            return std::nullopt;
+        }
+    }
+
+    //
+    // Request-reply round trip: sends the message and waits for a reply
+    // from the specified channel using a single syscall. Empty result means
+    // the request was rejected by the bounded channel and freed.
+    //
+    template<transferable R> 
+    auto call(message_owner<T> msg, const recv_channel<R>& reply) {
+        class awaitable {
+            const task::promise_type* promise_;
+            const std::uint32_t syscall_;
+
+        public:
+            constexpr bool await_ready() const { return false; }
+
+            void await_suspend(std::coroutine_handle<task::promise_type> h) {
+                h.promise().syscall_arg = syscall_;
+                promise_ = &h.promise();
+            }
+
+            std::optional<message_owner<R>> await_resume() const {
+                message_header* const msg = promise_->incoming_msg;
+
+                if (msg) {
+                    return message_owner<R>{static_cast<message<R>*>(msg)};
+                } else {
+                    return std::nullopt;
+                }
+            }
+
+            constexpr awaitable(std::uint32_t syscall) : 
+                promise_(nullptr), syscall_(syscall) {}
+        };
+
+        msg.drop();
+        const std::uint32_t dst = (id_ & chan_id_mask) << chan_id_bits;
+        const std::uint32_t src = reply.id_ & chan_id_mask;
+        return awaitable{syscall_id::MSG_CALL | dst | src};
     }
 
     consteval send_channel(std::uint32_t ident) noexcept : id_(ident) {}
 };
 
-static constexpr auto delay(std::uint32_t t) {
+//
+// Event channel carries bits ORed by notifications instead of messages. 
+// Waiting for events keeps the owned message, so message_owner remains valid.
+// Actors may set only the lower 14 bits.
+//
+class event_channel {
+    const std::uint32_t id_;
+
+public:
+    constexpr auto wait() const {
+        class awaitable {
+            const task::promise_type* promise_;
+            const std::uint32_t chan_id_;
+
+        public:    
+            constexpr bool await_ready() const { return false; }
+            
+            void await_suspend(std::coroutine_handle<task::promise_type> h) {
+                h.promise().syscall_arg = syscall_id::SUBSCRIBE | chan_id_;
+                promise_ = &h.promise();
+            }
+            
+            std::uint32_t await_resume() const {
+                return reinterpret_cast<std::uintptr_t>(promise_->incoming_msg);
+            }
+                       
+            constexpr awaitable(std::uint32_t ident) : 
+                promise_(nullptr), chan_id_(ident) {}
+        };
+        
+        return awaitable{id_};
+    }
+
+    std::uint32_t poll() const {
+        return reinterpret_cast<std::uintptr_t>(_ac_syscall(syscall_id::TRY_POP | id_));
+    }
+
+    void notify(std::uint32_t bits) const {
+        const std::uint32_t b = (bits & chan_id_mask) << chan_id_bits;
+        (void) _ac_syscall(syscall_id::NOTIFY | b | (id_ & chan_id_mask));
+    }
+
+    constexpr std::uint32_t id() const { return id_; }
+
+    consteval event_channel(std::uint32_t ident) noexcept : id_(ident) {}
+};
+
+//
+// Nonzero slack lets the kernel extend the delay by up to 'slack' ticks to
+// merge close expirations. Slack is limited to 16383 ticks, longer delays 
+// are plain ones.
+//
+static constexpr auto delay(std::uint32_t t, std::uint32_t slack = 0) {
     class awaitable {
         const std::uint32_t delay_;
+        const std::uint32_t slack_;
 
     public:
-        constexpr awaitable(std::uint32_t t) noexcept : delay_(t) {}
+        constexpr awaitable(std::uint32_t t, std::uint32_t s) noexcept : 
+            delay_(t), slack_(s) {}
         
         bool await_ready() const { return delay_ == 0; }
         
         void await_suspend(std::coroutine_handle<task::promise_type> h) const {
-            h.promise().syscall_arg = syscall_id::DELAY | delay_;
+            const std::uint32_t s = (slack_ < chan_id_mask) ? slack_ : chan_id_mask;
+            h.promise().syscall_arg = (slack_ == 0 || delay_ > chan_id_mask) ?
+                (syscall_id::DELAY | delay_) :
+                (syscall_id::DELAY_SLACK | (s << chan_id_bits) | delay_);
+        }
+        
+        void await_resume() const {}
+    };
+    
+    return awaitable{t, slack};
+}
+
+//
+// Delay in microseconds, rounded up to ticks unless the kernel is built with
+// the microsecond timer. Delays are clamped to 2^28-1 microseconds.
+//
+static constexpr auto delay_us(std::uint32_t t) {
+    class awaitable {
+        const std::uint32_t delay_;
+
+    public:
+        constexpr awaitable(std::uint32_t t) noexcept : 
+            delay_((t < syscall_arg_max) ? t : syscall_arg_max) {}
+        
+        bool await_ready() const { return delay_ == 0; }
+        
+        void await_suspend(std::coroutine_handle<task::promise_type> h) const {
+            h.promise().syscall_arg = syscall_id::DELAY_US | delay_;
+        }
+        
+        void await_resume() const {}
+    };
+    
+    return awaitable{t};
+}
+
+//
+// Resumes at the next release of the period, releases are spaced exactly by
+// the period since the first await regardless of the run time. Periods are
+// clamped to 2^28-1 ticks.
+//
+static constexpr auto periodic(std::uint32_t t) {
+    class awaitable {
+        const std::uint32_t period_;
+
+    public:
+        constexpr awaitable(std::uint32_t t) noexcept : 
+            period_((t < syscall_arg_max) ? t : syscall_arg_max) {}
+        
+        bool await_ready() const { return period_ == 0; }
+        
+        void await_suspend(std::coroutine_handle<task::promise_type> h) const {
+            h.promise().syscall_arg = syscall_id::PERIODIC | period_;
         }
         
         void await_resume() const {}
@@ -23,12 +23,24 @@ const SC_CHAN_POP: u32 = 1 << 28;
 const SC_CHAN_POLL: u32 = 2 << 28;
 const SC_MSG_SEND: u32 = 3 << 28;
 const SC_MSG_FREE: u32 = 4 << 28;
+const SC_MSG_CALL: u32 = 5 << 28;
+const SC_SELECT: u32 = 7 << 28;
+const SC_CHAN_POP_TIMED: u32 = 8 << 28;
+const SC_NOTIFY: u32 = 9 << 28;
+const SC_PERIODIC: u32 = 10 << 28;
+const SC_DELAY_US: u32 = 11 << 28;
+const SC_DELAY_SLACK: u32 = 12 << 28;
+
+const CHAN_ID_BITS: u32 = 14;
+const CHAN_ID_MASK: u32 = (1 << CHAN_ID_BITS) - 1;
+const SC_ARG_MAX: u32 = (1 << 28) - 1;
 
 #[repr(C)]
 struct MsgHeader {
     size: u32,
-    _padding: u32,
-    poisoned: u32
+    chan: u32,
+    poisoned: u16,
+    prio: u16
 }
 
 extern "C" {
@@ -69,6 +81,14 @@ impl<T: Sized + Send> Envelope<T> {
     pub fn is_poisoned(&self) -> bool {
         self.msg_ref.header.poisoned != 0
     }
+
+    //
+    // Used by priority-ordered channels, higher priority messages are 
+    // received first.
+    //
+    pub fn set_prio(&mut self, prio: u16) {
+        self.msg_ref.header.prio = prio;
+    }
     
     pub fn free(self) -> Token {
         mem::forget(self);
@@ -121,6 +141,109 @@ impl<T: Sized + Send> RecvChannel<T> {
     pub async fn pop(&self, _token: Token) -> Envelope<T> {
         self.await
     }
+
+    //
+    // Waits at most the specified number of ticks (up to 16383, longer ones are
+    // clamped). The token is returned back if the timeout expires first.
+    //
+    pub async fn pop_timeout(&self, token: Token, ticks: u32) -> Result<Envelope<T>, Token> {
+        let syscall = SC_CHAN_POP_TIMED | (ticks.min(CHAN_ID_MASK) << CHAN_ID_BITS) |
+            (self.id & CHAN_ID_MASK);
+        match (Timed { syscall, sent: false }).await {
+            Some(ptr) => Ok(Envelope::new(unsafe { msg_typecast::<T>(ptr) })),
+            None => Err(token)
+        }
+    }
+}
+
+//
+// The first poll issues the syscall, the next one is the completion either
+// by a message or by the timeout.
+//
+struct Timed {
+    syscall: u32,
+    sent: bool
+}
+
+impl Future for Timed {
+    type Output = Option<NonNull<MsgHeader>>;
+    fn poll(mut self: Pin<&mut Self>, _cx: &mut Context) -> Poll<Self::Output> {
+        unsafe {
+            if !self.sent {
+                self.sent = true;
+                IPC = Mailbox::Subscription(self.syscall);
+                Poll::Pending
+            } else if let Mailbox::Message(ptr) = IPC {
+                Poll::Ready(Some(ptr))
+            } else {
+                Poll::Ready(None)
+            }
+        }
+    }
+}
+
+//
+// Message of the broadcast channel. The same block is mapped read-only to 
+// all the readers and is returned into the pool after the last one frees it.
+//
+pub struct Shared<T: Sized + Send + 'static> {
+    msg_ref: &'static Msg<T>
+}
+
+impl<T: Sized + Send> Shared<T> {
+    pub fn free(self) -> Token {
+        mem::forget(self);
+        unsafe {
+            _ac_syscall(SC_MSG_FREE);
+        }
+        Token::new()
+    }
+}
+
+impl<T: Send> Deref for Shared<T> {
+    type Target = T;
+    fn deref(&self) -> &T {
+        &self.msg_ref.payload
+    }
+}
+
+impl<T: Send> Drop for Shared<T> {
+    fn drop(&mut self) {
+        panic!("dropped msg");
+    }
+}
+
+pub struct BroadcastChannel<T: Sized + Send + 'static> {
+    id: u32,
+    _marker: PhantomData<&'static T>
+}
+
+impl<T: Sized + Send> BroadcastChannel<T> {
+    pub const fn new(id: u32) -> Self {
+        Self {
+            id,
+            _marker: PhantomData
+        }
+    }
+
+    pub async fn pop(&self, _token: Token) -> Shared<T> {
+        self.await
+    }
+}
+
+impl<T: Sized + Send> Future for &BroadcastChannel<T> {
+    type Output = Shared<T>;
+    fn poll(self: Pin<&mut Self>, _cx: &mut Context) -> Poll<Self::Output> {
+        unsafe {
+            if let Mailbox::Message(ptr) = IPC {
+                let msg = msg_typecast::<T>(ptr);
+                Poll::Ready(Shared { msg_ref: msg })
+            } else {
+                IPC = Mailbox::Subscription(self.id | SC_CHAN_POP);
+                Poll::Pending
+            }
+        }
+    }
 }
 
 enum Mailbox {
@@ -217,6 +340,148 @@ impl Drop for HeaderPtr {
     }
 }
 
+//
+// Set of up to 14 channels with consecutive ids starting from the base.
+// Awaiting the set returns the first message from any of its channels.
+//
+pub struct ChannelSet {
+    base: u32,
+    mask: u32
+}
+
+impl ChannelSet {
+    pub const fn new(base: u32) -> Self {
+        Self {
+            base,
+            mask: 0
+        }
+    }
+
+    pub const fn with<T: Sized + Send>(self, chan: &RecvChannel<T>) -> Self {
+        self.with_id(chan.id)
+    }
+
+    pub const fn with_raw(self, chan: &RawRecvChannel) -> Self {
+        self.with_id(chan.id)
+    }
+
+    const fn with_id(self, id: u32) -> Self {
+        assert!(id >= self.base && id - self.base < CHAN_ID_BITS);
+        Self {
+            base: self.base,
+            mask: self.mask | (1 << (id - self.base))
+        }
+    }
+
+    pub async fn select(&self, _token: Token) -> Selected {
+        self.await
+    }
+}
+
+impl Future for &ChannelSet {
+    type Output = Selected;
+    fn poll(self: Pin<&mut Self>, _cx: &mut Context) -> Poll<Self::Output> {
+        unsafe {
+            if let Mailbox::Message(ptr) = IPC {
+                Poll::Ready(Selected { ptr: HeaderPtr::new(ptr) })
+            } else {
+                let arg = ((self.base & CHAN_ID_MASK) << CHAN_ID_BITS) | self.mask;
+                IPC = Mailbox::Subscription(SC_SELECT | arg);
+                Poll::Pending
+            }
+        }
+    }
+}
+
+//
+// Message received from one of the channels of the set. It is converted into
+// the typed envelope using the channel it came from.
+//
+pub struct Selected {
+    ptr: HeaderPtr
+}
+
+impl Selected {
+    pub fn channel(&self) -> u32 {
+        unsafe { self.ptr.ptr.as_ref().chan }
+    }
+
+    pub fn take<T: Sized + Send>(self, chan: &RecvChannel<T>) -> Result<Envelope<T>, Selected> {
+        if self.channel() == chan.id {
+            Ok(unsafe { self.ptr.convert::<T>() })
+        } else {
+            Err(self)
+        }
+    }
+
+    pub fn raw(self) -> HeaderPtr {
+        self.ptr
+    }
+
+    pub fn free(self) -> Token {
+        self.ptr.free()
+    }
+}
+
+//
+// Channel of event bits ORed by notifications. Waiting for events needs no
+// token since the owned message, if any, is kept. Actors may set only the 
+// lower 14 bits.
+//
+pub struct EventChannel {
+    id: u32
+}
+
+impl EventChannel {
+    pub const fn new(id: u32) -> Self {
+        Self {
+            id
+        }
+    }
+
+    pub fn poll(&self) -> u32 {
+        unsafe { _ac_syscall(SC_CHAN_POLL | self.id) as usize as u32 }
+    }
+
+    pub async fn wait(&self) -> u32 {
+        (Events { syscall: SC_CHAN_POP | self.id, sent: false }).await
+    }
+
+    pub fn notify(&self, bits: u32) {
+        let arg = ((bits & CHAN_ID_MASK) << CHAN_ID_BITS) | (self.id & CHAN_ID_MASK);
+        unsafe {
+            _ac_syscall(SC_NOTIFY | arg);
+        }
+    }
+}
+
+//
+// The actor is started with the event bits in place of the message pointer.
+//
+struct Events {
+    syscall: u32,
+    sent: bool
+}
+
+impl Future for Events {
+    type Output = u32;
+    fn poll(mut self: Pin<&mut Self>, _cx: &mut Context) -> Poll<Self::Output> {
+        unsafe {
+            if !self.sent {
+                self.sent = true;
+                IPC = Mailbox::Subscription(self.syscall);
+                Poll::Pending
+            } else if let Mailbox::Message(ptr) = IPC {
+                IPC = Mailbox::MessageWaiting;
+                Poll::Ready(ptr.as_ptr() as usize as u32)
+            } else {
+                IPC = Mailbox::Subscription(self.syscall);
+                Poll::Pending
+            }
+        }
+    }
+}
+
 pub struct SendChannel<T: Sized + Send + 'static> {
     id: u32,
     _marker: PhantomData<&'static T>
@@ -230,21 +495,88 @@ impl<T: Sized + Send> SendChannel<T> {
         }
     }
     
-    pub fn send(&mut self, msg: Envelope<T>) -> Token {
+    //
+    // Bounded channel returns the message back when it is full.
+    //
+    pub fn send(&mut self, msg: Envelope<T>) -> Result<Token, Envelope<T>> {
+        mem::forget(msg);
+        let rejected = unsafe { _ac_syscall(self.id | SC_MSG_SEND) };
+
+        match NonNull::new(rejected) {
+            None => Ok(Token::new()),
+            Some(ptr) => Err(Envelope::new(unsafe { msg_typecast::<T>(ptr) }))
+        }
+    }
+    
+    //
+    // If the request is rejected by the bounded channel it is freed and the
+    // token is returned instead of the reply.
+    //
+    pub async fn call<R: Sized + Send>(&mut self, msg: Envelope<T>, reply: &RecvChannel<R>) -> Result<Envelope<R>, Token> {
         mem::forget(msg);
+        let dst = (self.id & CHAN_ID_MASK) << CHAN_ID_BITS;
+        let src = reply.id & CHAN_ID_MASK;
+        Call::<R> { syscall: SC_MSG_CALL | dst | src, sent: false, _marker: PhantomData }.await
+    }
+}
+
+//
+// Send and subscribe are combined into a single syscall. The first poll
+// issues the syscall, the second one is either a reply delivery or the
+// rejection of the request.
+//
+struct Call<R: Sized + Send + 'static> {
+    syscall: u32,
+    sent: bool,
+    _marker: PhantomData<&'static R>
+}
+
+impl<R: Sized + Send> Future for Call<R> {
+    type Output = Result<Envelope<R>, Token>;
+    fn poll(mut self: Pin<&mut Self>, _cx: &mut Context) -> Poll<Self::Output> {
         unsafe {
-            _ac_syscall(self.id | SC_MSG_SEND);
+            if !self.sent {
+                self.sent = true;
+                IPC = Mailbox::Subscription(self.syscall);
+                Poll::Pending
+            } else if let Mailbox::Message(ptr) = IPC {
+                let msg = msg_typecast::<R>(ptr);
+                Poll::Ready(Ok(Envelope::new(msg)))
+            } else {
+                Poll::Ready(Err(Token::new()))
+            }
         }
-        Token::new()
     }
 }
 
 pub struct Timer {
-    delay: u32
+    delay: u32,
+    syscall: u32
 }
 
 pub fn delay(ticks: u32) -> Timer {
-    Timer { delay: ticks }
+    Timer { delay: ticks, syscall: SC_DELAY }
+}
+
+//
+// Slack is limited to 16383 ticks, longer delays are plain ones.
+//
+pub fn delay_slack(ticks: u32, slack: u32) -> Timer {
+    if ticks > CHAN_ID_MASK {
+        return delay(ticks);
+    }
+
+    let delay = if ticks == 0 { 0 } else {
+        (slack.min(CHAN_ID_MASK) << CHAN_ID_BITS) | ticks
+    };
+    Timer { delay, syscall: SC_DELAY_SLACK }
+}
+
+//
+// Delays are clamped to 2^28-1 microseconds.
+//
+pub fn delay_us(us: u32) -> Timer {
+    Timer { delay: us.min(SC_ARG_MAX), syscall: SC_DELAY_US }
 }
 
 impl Future for Timer {
@@ -252,7 +584,7 @@ impl Future for Timer {
     fn poll(mut self: Pin<&mut Self>, _cx: &mut Context) -> Poll<Self::Output> {
         if self.delay > 0 {
             unsafe {
-                IPC = Mailbox::Subscription(self.delay | SC_DELAY);
+                IPC = Mailbox::Subscription(self.delay | self.syscall);
             }
             self.delay = 0;
             Poll::Pending
@@ -262,6 +594,32 @@ impl Future for Timer {
     }
 }
 
+pub struct Periodic {
+    period: u32
+}
+
+//
+// Periods are clamped to 2^28-1 ticks.
+//
+pub fn periodic(ticks: u32) -> Periodic {
+    Periodic { period: ticks.min(SC_ARG_MAX) }
+}
+
+impl Future for Periodic {
+    type Output = ();
+    fn poll(mut self: Pin<&mut Self>, _cx: &mut Context) -> Poll<Self::Output> {
+        if self.period > 0 {
+            unsafe {
+                IPC = Mailbox::Subscription(self.period | SC_PERIODIC);
+            }
+            self.period = 0;
+            Poll::Pending
+        } else {
+            Poll::Ready(())
+        }
+    }
+}
+
 pub const fn size_of<F>(_future: &impl FnOnce(Token) -> F) -> usize {
     mem::size_of::<F>()
 }